@@ -0,0 +1,198 @@
+/**
+ * Wii64 - fileBrowser-ROMZ.c
+ *
+ * fileBrowser module for block compressed ROM images
+ *   This sits on top of whichever fileBrowser the ROM was opened with
+ *   and only decompresses the blocks that are actually read.
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+
+#include <string.h>
+#include <stdlib.h>
+#include <zlib.h>
+#include "fileBrowser.h"
+#include "fileBrowser-ROMZ.h"
+#include "../main/lz4.h"
+
+// The container as the device reader sees it, and the ROM as handed to
+//   ROMCache: both are our own copies, the caller's file is never touched
+static fileBrowser_file ROMZ_raw, ROMZ_rom;
+static int ROMZ_isOpen;
+static unsigned int ROMZ_codec, ROMZ_shift, ROMZ_numBlocks;
+static unsigned int* ROMZ_index;
+// The last block decompressed for a partial read, and the compressed input
+static unsigned char* ROMZ_block;
+static int ROMZ_cachedBlock = -1;
+static unsigned char* ROMZ_comp;
+static z_stream ROMZ_zs;
+static int (*raw_readFile)(fileBrowser_file*, void*, unsigned int);
+static int (*raw_seekFile)(fileBrowser_file*, unsigned int, unsigned int);
+
+static unsigned int get_be32(unsigned char* p){
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int raw_read(unsigned int offset, void* buffer, unsigned int length){
+	raw_seekFile(&ROMZ_raw, offset, FILE_BROWSER_SEEK_SET);
+	return raw_readFile(&ROMZ_raw, buffer, length);
+}
+
+static unsigned int block_length(unsigned int block){
+	unsigned int start = block << ROMZ_shift;
+	unsigned int size = 1 << ROMZ_shift;
+	return start + size > ROMZ_rom.size ? ROMZ_rom.size - start : size;
+}
+
+static int decode_block(unsigned int block, unsigned char* dst){
+	unsigned int length = block_length(block);
+	unsigned int comp_len = ROMZ_index[block+1] - ROMZ_index[block];
+
+	// Blocks which didn't compress are stored as is
+	if(comp_len == length)
+		return raw_read(ROMZ_index[block], dst, length) == length ? 0 : -1;
+
+	if(raw_read(ROMZ_index[block], ROMZ_comp, comp_len) != comp_len)
+		return -1;
+
+	if(ROMZ_codec == ROMZ_CODEC_LZ4)
+		return lz4_decompress(ROMZ_comp, comp_len, dst, length) == length ? 0 : -1;
+
+	inflateReset(&ROMZ_zs);
+	ROMZ_zs.next_in   = ROMZ_comp;
+	ROMZ_zs.avail_in  = comp_len;
+	ROMZ_zs.next_out  = dst;
+	ROMZ_zs.avail_out = length;
+	if(inflate(&ROMZ_zs, Z_FINISH) != Z_STREAM_END || ROMZ_zs.avail_out)
+		return -1;
+	return 0;
+}
+
+int fileBrowser_ROMZ_readFile(fileBrowser_file* file, void* buffer, unsigned int length){
+	unsigned char* dst = buffer;
+	unsigned int done = 0;
+
+	if(file->offset >= file->size) return 0;
+	if(length > file->size - file->offset) length = file->size - file->offset;
+
+	while(done < length){
+		unsigned int block = file->offset >> ROMZ_shift;
+		unsigned int block_offset = file->offset & ((1 << ROMZ_shift) - 1);
+		unsigned int count = block_length(block) - block_offset;
+		if(count > length - done) count = length - done;
+
+		if(block == ROMZ_cachedBlock){
+			memcpy(dst, ROMZ_block + block_offset, count);
+		} else if(!block_offset && count == block_length(block)){
+			// Whole blocks (ROMCache misses) are decoded in place
+			if(decode_block(block, dst)) return FILE_BROWSER_ERROR;
+		} else {
+			ROMZ_cachedBlock = -1;
+			if(decode_block(block, ROMZ_block)) return FILE_BROWSER_ERROR;
+			ROMZ_cachedBlock = block;
+			memcpy(dst, ROMZ_block + block_offset, count);
+		}
+
+		dst += count; done += count; file->offset += count;
+	}
+	return done;
+}
+
+int fileBrowser_ROMZ_seekFile(fileBrowser_file* file, unsigned int where, unsigned int type){
+	if(type == FILE_BROWSER_SEEK_SET) file->offset = where;
+	else if(type == FILE_BROWSER_SEEK_CUR) file->offset += where;
+	else file->offset = file->size + where;
+
+	return 0;
+}
+
+void fileBrowser_ROMZ_close(void){
+	if(!ROMZ_isOpen) return;
+
+	// Only put the readers back if the menu hasn't switched devices since
+	if(romFile_readFile == fileBrowser_ROMZ_readFile)
+		romFile_readFile = raw_readFile;
+	if(romFile_seekFile == fileBrowser_ROMZ_seekFile)
+		romFile_seekFile = raw_seekFile;
+
+	inflateEnd(&ROMZ_zs);
+	free(ROMZ_index); free(ROMZ_block); free(ROMZ_comp);
+	ROMZ_index = NULL; ROMZ_block = ROMZ_comp = NULL;
+	ROMZ_cachedBlock = -1;
+	ROMZ_isOpen = 0;
+}
+
+int fileBrowser_ROMZ_open(fileBrowser_file* file, fileBrowser_file** rom){
+	unsigned char header[ROMZ_HEADER_SIZE];
+	unsigned int i, max_comp = 0;
+
+	fileBrowser_ROMZ_close();
+	*rom = file;
+
+	raw_readFile = romFile_readFile;
+	raw_seekFile = romFile_seekFile;
+	ROMZ_raw     = *file;
+	if(raw_read(0, header, ROMZ_HEADER_SIZE) != ROMZ_HEADER_SIZE ||
+	   get_be32(header) != ROMZ_MAGIC)
+		return 0;
+	if(get_be32(header+4) != ROMZ_VERSION) return FILE_BROWSER_ERROR;
+
+	ROMZ_codec     = get_be32(header+8);
+	ROMZ_shift     = get_be32(header+12);
+	ROMZ_numBlocks = get_be32(header+20);
+	if((ROMZ_codec != ROMZ_CODEC_ZLIB && ROMZ_codec != ROMZ_CODEC_LZ4) ||
+	   ROMZ_shift < 12 || ROMZ_shift > 20 ||
+	   ROMZ_numBlocks != (get_be32(header+16) + (1 << ROMZ_shift) - 1) >> ROMZ_shift)
+		return FILE_BROWSER_ERROR;
+
+	ROMZ_rom        = *file;
+	ROMZ_rom.size   = get_be32(header+16);
+	ROMZ_rom.offset = 0;
+
+	// Read in and validate the block index
+	ROMZ_index = malloc((ROMZ_numBlocks+1) * sizeof(unsigned int));
+	if(!ROMZ_index ||
+	   raw_read(ROMZ_HEADER_SIZE, ROMZ_index, (ROMZ_numBlocks+1) * 4) != (ROMZ_numBlocks+1) * 4){
+		free(ROMZ_index); ROMZ_index = NULL;
+		return FILE_BROWSER_ERROR;
+	}
+	for(i=0; i<=ROMZ_numBlocks; ++i){
+		ROMZ_index[i] = get_be32((unsigned char*)&ROMZ_index[i]);
+		if(i && ROMZ_index[i] - ROMZ_index[i-1] > max_comp)
+			max_comp = ROMZ_index[i] - ROMZ_index[i-1];
+		if((i && ROMZ_index[i] < ROMZ_index[i-1]) || ROMZ_index[i] > ROMZ_raw.size){
+			free(ROMZ_index); ROMZ_index = NULL;
+			return FILE_BROWSER_ERROR;
+		}
+	}
+
+	// Scratch buffers are allocated once per image, not per read
+	ROMZ_block = malloc(1 << ROMZ_shift);
+	ROMZ_comp  = malloc(max_comp ? max_comp : 1);
+	memset(&ROMZ_zs, 0, sizeof(z_stream));
+	if(!ROMZ_block || !ROMZ_comp || inflateInit(&ROMZ_zs) != Z_OK){
+		free(ROMZ_index); free(ROMZ_block); free(ROMZ_comp);
+		ROMZ_index = NULL; ROMZ_block = ROMZ_comp = NULL;
+		return FILE_BROWSER_ERROR;
+	}
+
+	ROMZ_isOpen = 1;
+	*rom = &ROMZ_rom;
+	romFile_readFile = fileBrowser_ROMZ_readFile;
+	romFile_seekFile = fileBrowser_ROMZ_seekFile;
+	return 1;
+}
+
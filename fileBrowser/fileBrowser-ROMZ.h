@@ -0,0 +1,57 @@
+/**
+ * Wii64 - fileBrowser-ROMZ.h
+ *
+ * fileBrowser module for block compressed ROM images
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+
+#ifndef FILE_BROWSER_ROMZ_H
+#define FILE_BROWSER_ROMZ_H
+
+#include "fileBrowser.h"
+
+/* ROMZ file layout, all fields are big endian u32:
+     header    magic "ROMZ", version, codec, block_shift, rom_size, num_blocks
+     index     num_blocks+1 file offsets, block i is [index[i], index[i+1])
+     blocks    each compressed on its own with the header's codec,
+               or stored as is when that wouldn't make it any smaller
+   The ROM data keeps whatever byte order the source image had.
+   tools/romz.c converts .z64/.v64/.n64 images to this format.        */
+#define ROMZ_MAGIC       0x524F4D5A // "ROMZ"
+#define ROMZ_VERSION     1
+#define ROMZ_HEADER_SIZE 24
+#define ROMZ_CODEC_ZLIB  1
+#define ROMZ_CODEC_LZ4   2
+// Matches the ROMCache block size, so a cache miss decompresses one block
+#define ROMZ_BLOCK_SHIFT 16
+
+/* Checks whether file is a ROMZ image and if so, points romFile_readFile
+     and romFile_seekFile at the decompressing readers. *rom is set to the
+     file the ROM should be read through: for a ROMZ image that's a copy
+     of file with the uncompressed ROM size, otherwise file itself.
+     file itself is left alone, it may be freed by the browser.
+   - returns 1 for a ROMZ image, 0 for anything else, < 0 on error */
+int fileBrowser_ROMZ_open(fileBrowser_file* file, fileBrowser_file** rom);
+/* Puts back the readers replaced by fileBrowser_ROMZ_open,
+     this must be called when the ROM is unloaded */
+void fileBrowser_ROMZ_close(void);
+
+int fileBrowser_ROMZ_readFile(fileBrowser_file*, void*, unsigned int);
+int fileBrowser_ROMZ_seekFile(fileBrowser_file*, unsigned int, unsigned int);
+
+#endif
+
@@ -25,56 +25,75 @@
 
 /*  MEMORY USAGE:
      STATIC:
-   	Audio Buffer: 4x BUFFER_SIZE (currently ~3kb each)
-   	LWP Control Buffer: 1Kb
+   	Audio Ring: RING_CHUNKS x BUFFER_SIZE/2 (currently ~15kb)
 */
 
 #include "../main/winlnxdefs.h"
 #include <stdio.h>
 #include <gccore.h>
 #include <string.h>
-#include <math.h>
 #include <ogc/audio.h>
 #include <ogc/cache.h>
-#ifdef THREADED_AUDIO
 #include <ogc/lwp.h>
-#include <ogc/semaphore.h>
-#endif
 
 #include "AudioPlugin.h"
 #include "Audio_#1.1.h"
 #include "../gui/DEBUG.h"
+#include "../main/wii64config.h"
 
 AUDIO_INFO AudioInfo;
 
-#define NUM_BUFFERS 4
+/* Samples go out through a ring of chunks with one producer, AiLenChanged,
+ * and one consumer, the AI DMA interrupt.  Each side only ever writes its
+ * own counters so neither takes a lock: the producer resamples into the
+ * chunk at ring_write and publishes it, the interrupt queues ring_queue to
+ * be played next and frees chunks into ring_read once the DMA is past
+ * them.  The counters only count up, a chunk's index is its count modulo
+ * RING_CHUNKS.  If nothing is ready when the interrupt comes, silence is
+ * played until there is, rather than repeating the last chunk.
+ *
+ * A chunk is half a frame's worth of samples, so playback can start as
+ * soon as that much is ready.  RING_CHUNKS bounds how far ahead of the
+ * DMA the game can get before AiLenChanged waits, audioLatency is where
+ * the rate control below tries to keep it.
+ */
+
+#define RING_CHUNKS 8 // Must be a power of 2
 #define BUFFER_SIZE 3840
-static char buffer[NUM_BUFFERS][BUFFER_SIZE] __attribute__((aligned(32)));
-static int which_buffer = 0;
-static unsigned int buffer_offset = 0;
-#define NEXT(x) (x=(x+1)%NUM_BUFFERS)
+#define CHUNK_MAX   (BUFFER_SIZE / 2)
+#define RING_INDEX(x) ((x) & (RING_CHUNKS - 1))
+static char ring[RING_CHUNKS][CHUNK_MAX] __attribute__((aligned(32)));
+static char silence[CHUNK_MAX] __attribute__((aligned(32)));
+static volatile unsigned int ring_write, ring_queue, ring_read;
+static unsigned int chunk_offset = 0;
+static volatile int dma_running, dma_current, dma_queued;
+static lwpq_t ring_wait = LWP_TQUEUE_NULL;
 static unsigned int freq;
 static unsigned int real_freq;
-static float freq_ratio;
+// Source frames per output frame in 16.16 fixed point
+static unsigned int freq_step, base_step;
 // NOTE: 32khz actually uses ~2136 bytes/frame @ 60hz
 static enum { BUFFER_SIZE_32_60 = 2112, BUFFER_SIZE_48_60 = 3200,
               BUFFER_SIZE_32_50 = 2560, BUFFER_SIZE_48_50 = 3840 } buffer_size;
-
-#ifdef THREADED_AUDIO
-static lwp_t audio_thread;
-static sem_t buffer_full;
-static sem_t buffer_empty;
-static sem_t audio_free;
-static sem_t first_audio;
-static int   thread_running = 0;
-#define AUDIO_STACK_SIZE 1024 // MEM: I could get away with a smaller stack
-static char  audio_stack[AUDIO_STACK_SIZE];
-#define AUDIO_PRIORITY 100
-static int   thread_buffer = 0;
-static int   audio_paused = 0;
-#else // !THREADED_AUDIO
-#define thread_buffer which_buffer
-#endif
+#define chunk_size (buffer_size / 2)
+
+// Position of the next output in the input, in 16.16 fixed point,
+//   where 0 is the last frame of the previous input and 1 is the first
+static unsigned int resample_pos;
+static short resample_last[2];
+
+/* With a target latency set, how full the ring is gets measured each time
+ * the game hands over samples, and freq_step is moved up to 1/RATE_RANGE
+ * either side of base_step to steer it back to the target: more output
+ * per input when it's running low, less when it's getting full.  Nobody
+ * hears 0.5%, but it's enough to soak up the difference between the VI
+ * rate and the DAC, so the ring can be kept short without running dry or
+ * making AiLenChanged wait.  The fill only moves a chunk at a time as
+ * seen from here, so it's averaged over a few calls first.
+ */
+#define RATE_RANGE 200
+char audioLatency = AUDIOLATENCY_DEFAULT;
+static int fill_avg; // Frames buffered, averaged, times 8
 
 #ifdef AIDUMP
 FILE *AIdump=NULL;
@@ -120,7 +139,7 @@ AiDacrateChanged( int SystemType )
 	diff48 = diff48 > 0 ? diff48 : -diff48;
 	// Choose the closest real frequency
 	real_freq = (diff32 < diff48) ? 32000 : 48000;
-	freq_ratio = (float)freq / real_freq;
+	base_step = freq_step = ((unsigned long long)freq << 16) / real_freq;
 
 	if( real_freq == 32000 ){
 		AUDIO_SetDSPSampleRate(AI_SAMPLERATE_32KHZ);
@@ -132,133 +151,170 @@ AiDacrateChanged( int SystemType )
 		               BUFFER_SIZE_48_60 : BUFFER_SIZE_48_50;
 	}
 #ifdef SHOW_DEBUG
-	sprintf(txtbuffer, "Initializing frequency: %d (resampling ratio %f)",
-	        real_freq, freq_ratio);
+	sprintf(txtbuffer, "Initializing frequency: %d (resampling step 0x%x)",
+	        real_freq, freq_step);
 	DEBUG_print(txtbuffer,DBG_AUDIOINFO);
 #endif
 }
 
-#ifdef THREADED_AUDIO
+// Called from the DMA interrupt as the chunk queued last time starts
 static void done_playing(void){
-	// We're done playing, so we're releasing a buffer and the audio
-	LWP_SemPost(buffer_empty);
-	LWP_SemPost(audio_free);
+	// The chunk before that one has been played out
+	if(dma_current) ring_read = ring_read + 1;
+	dma_current = dma_queued;
+
+	dma_queued = ring_write != ring_queue;
+	if(dma_queued){
+		AUDIO_InitDMA((unsigned int)ring[RING_INDEX(ring_queue)], chunk_size);
+		ring_queue = ring_queue + 1;
+	} else
+		AUDIO_InitDMA((unsigned int)silence, chunk_size);
+
+	LWP_ThreadBroadcast(ring_wait);
 }
-#endif
 
-static void inline play_buffer(void){
-#ifndef THREADED_AUDIO
-	// We should wait for the other buffer to finish its DMA transfer first
-	while( AUDIO_GetDMABytesLeft() );
-	AUDIO_StopDMA();
+// Starts playing whatever has been published, with interrupts disabled
+static void start_dma(void){
+	if(dma_running || ring_write == ring_queue) return;
 
-#else // THREADED_AUDIO
-	// Wait for a sample to actually be played to work around a deadlock
-	LWP_SemWait(first_audio);
-	
-	// This thread will keep giving buffers to the audio as they come
-	while(thread_running){
+	AUDIO_InitDMA((unsigned int)ring[RING_INDEX(ring_queue)], chunk_size);
+	ring_queue = ring_queue + 1;
+	dma_current = 0;
+	dma_queued  = 1;
+	dma_running = 1;
+	AUDIO_StartDMA();
+}
 
-	// Wait for a buffer to be processed
-	LWP_SemWait(buffer_full);
-#endif
+// Stops the DMA and frees what it was playing, with interrupts disabled
+static void stop_dma(void){
+	AUDIO_StopDMA();
+	dma_running = 0;
+	dma_current = dma_queued = 0;
+	ring_read = ring_queue;
+	LWP_ThreadBroadcast(ring_wait);
+}
 
-	// Make sure the buffer is in RAM, not the cache
-	DCFlushRange(buffer[thread_buffer], buffer_size);
+// Waits for the chunk at ring_write to be free to write into
+static void wait_for_chunk(void){
+	unsigned int level;
+	if(ring_write - ring_read < RING_CHUNKS) return;
 
-	// Actually send the buffer out to be played next
-	AUDIO_InitDMA((unsigned int)&buffer[thread_buffer], buffer_size);
+	_CPU_ISR_Disable(level);
+	while(ring_write - ring_read >= RING_CHUNKS){
+		// A full ring that isn't playing would never drain
+		start_dma();
+		LWP_ThreadSleep(ring_wait);
+	}
+	_CPU_ISR_Restore(level);
+}
+
+static void publish_chunk(void){
+	unsigned int level;
+	char* chunk = ring[RING_INDEX(ring_write)];
 
-#ifdef THREADED_AUDIO
-	// Wait for the audio interface to be free before playing
-	LWP_SemWait(audio_free);
+	// Make sure the chunk is in RAM, not the cache
+	DCFlushRange(chunk, chunk_size);
+#ifdef AIDUMP
+	if(AIdump)
+	    fwrite(chunk,1,chunk_size,AIdump);
 #endif
 
-	// Start playing the buffer
-	AUDIO_StartDMA();
+	_CPU_ISR_Disable(level);
+	ring_write = ring_write + 1;
+	start_dma();
+	_CPU_ISR_Restore(level);
+	chunk_offset = 0;
+}
+
+// Frames handed over that haven't been played yet
+static int buffered_frames(void){
+	unsigned int level, bytes;
+	_CPU_ISR_Disable(level);
+	bytes = (ring_write - ring_queue) * chunk_size + chunk_offset;
+	if(dma_queued)  bytes += chunk_size;
+	if(dma_current) bytes += AUDIO_GetDMABytesLeft();
+	_CPU_ISR_Restore(level);
+	return bytes >> 2;
+}
+
+static int target_frames(void){
+	// Leave room for a chunk being written and one more
+	int most = (RING_CHUNKS - 2) * (chunk_size >> 2);
+	int target = audioLatency * real_freq / 1000;
+	return target < most ? target : most;
+}
 
-#ifdef THREADED_AUDIO
-	// Move the index to the next buffer
-	NEXT(thread_buffer);
+static void update_rate(void){
+	int target, err;
+	fill_avg += buffered_frames() - fill_avg / 8;
+	if(!audioLatency || !real_freq){
+		freq_step = base_step;
+		return;
 	}
-#endif
+
+	target = target_frames();
+	err = fill_avg / 8 - target;
+	if(err >  target) err =  target;
+	if(err < -target) err = -target;
+	freq_step = base_step + (long long)base_step * err / (target * RATE_RANGE);
 }
 
-static void inline copy_to_buffer(int* buffer, int* stream, unsigned int length){
-	// NOTE: length is in samples (stereo (2) shorts)
-	int di;
-	float si;
-	for(di = 0, si = 0.0f; di < length; ++di, si += freq_ratio){
-#if 1
-		// Linear interpolation between current and next sample
-		float t = si - floorf(si);
-		short* osample  = (short*)(buffer + di);
-		short* isample1 = (short*)(stream + (int)si);
-		short* isample2 = (short*)(stream + (int)ceilf(si));
-		// Left and right
-		osample[0] = (1.0f - t)*isample1[0] + t*isample2[0];
-		osample[1] = (1.0f - t)*isample1[1] + t*isample2[1];
-#else
-		// Quick and dirty resampling: skip over or repeat samples
-		buffer[di] = stream[(int)si];
-#endif
+void audio_get_stats(unsigned int* fill_us, int* rate_ppm){
+	*fill_us  = real_freq ? (long long)fill_avg * 1000000 / 8 / real_freq : 0;
+	*rate_ppm = base_step ? ((long long)freq_step - base_step) * 1000000 / base_step : 0;
+}
+
+static inline void lerp(short* out, const short* a, const short* b, unsigned int pos){
+	int t = (pos >> 1) & 0x7FFF;
+	out[0] = a[0] + (((b[0] - a[0]) * t) >> 15);
+	out[1] = a[1] + (((b[1] - a[1]) * t) >> 15);
+}
+
+/* Linearly interpolates stereo frames from in (in_frames of them) into
+ * out, stepping resample_pos, until out_frames are written or the input
+ * runs out.
+ *   Returns the number of frames written
+ */
+static int resample(short* out, int out_frames, const short* in, unsigned int in_frames){
+	unsigned int pos = resample_pos, step = freq_step;
+	int n = 0;
+
+	// Between the last frame of the previous input and the first of this
+	for(; n < out_frames && pos < 0x10000; ++n, pos += step)
+		lerp(out + 2*n, resample_last, in, pos);
+
+	for(; n < out_frames && (pos >> 16) < in_frames; ++n, pos += step){
+		const short* a = in + 2*((pos >> 16) - 1);
+		lerp(out + 2*n, a, a + 2, pos);
 	}
+
+	resample_pos = pos;
+	return n;
 }
 
-static void inline add_to_buffer(void* stream, unsigned int length){
-	// This shouldn't lose any data and works for any size
-	unsigned int stream_offset = 0;
-	// Length calculations are in samples (stereo (short) sample pairs)
-	unsigned int lengthi, rlengthi;
-	unsigned int lengthLeft = length >> 2;
-	unsigned int rlengthLeft = ceilf(lengthLeft / freq_ratio);
-	while(1){
-		rlengthi = (buffer_offset + (rlengthLeft << 2) <= buffer_size) ?
-		            rlengthLeft : ((buffer_size - buffer_offset) >> 2);
-		lengthi  = rlengthi * freq_ratio;
-
-#ifdef THREADED_AUDIO
-		// Wait for a buffer we can copy into
-		LWP_SemWait(buffer_empty);
-#endif
-		copy_to_buffer(buffer[which_buffer] + buffer_offset,
-		               stream + stream_offset, rlengthi);
-
-		if(buffer_offset + (rlengthLeft << 2) < buffer_size){
-			buffer_offset += rlengthi << 2;
-#ifdef THREADED_AUDIO
-			// This is a little weird, but we didn't fill this buffer.
-			//   So it is still considered 'empty', but since we 'decremented'
-			//   buffer_empty coming in here, we want to set it back how
-			//   it was, so we don't cause a deadlock
-			LWP_SemPost(buffer_empty);
-#endif
-			return;
-		}
-
-		lengthLeft    -= lengthi;
-		stream_offset += lengthi << 2;
-		rlengthLeft   -= rlengthi;
-
-#ifdef THREADED_AUDIO
-		// Start the thread if this is the first sample
-		if(!thread_running){
-			thread_running = 1;
-			LWP_SemPost(first_audio);
-		}
-		
-		// Let the audio thread know that we've filled a new buffer
-		LWP_SemPost(buffer_full);
-#else
-		play_buffer();
-#endif
-#ifdef AIDUMP
-		if(AIdump)
-	    fwrite(&buffer[which_buffer][0],1,buffer_size,AIdump);
-#endif
-		NEXT(which_buffer);
-		buffer_offset = 0;
+static void add_to_buffer(const short* stream, unsigned int length){
+	// Length calculations are in frames (stereo short sample pairs)
+	unsigned int frames = length >> 2;
+	if(!frames) return;
+	update_rate();
+
+	while((resample_pos >> 16) < frames){
+		short* chunk;
+		int n;
+		// The rate can change under a partly filled chunk
+		if(chunk_offset >= chunk_size) publish_chunk();
+
+		wait_for_chunk();
+		chunk = (short*)(ring[RING_INDEX(ring_write)] + chunk_offset);
+		n = resample(chunk, (chunk_size - chunk_offset) >> 2, stream, frames);
+		chunk_offset += n << 2;
+
+		if(chunk_offset >= chunk_size) publish_chunk();
 	}
+
+	resample_pos -= frames << 16;
+	resample_last[0] = stream[2*frames-2];
+	resample_last[1] = stream[2*frames-1];
 }
 
 EXPORT void CALL
@@ -322,40 +378,34 @@ InitiateAudio( AUDIO_INFO Audio_Info )
 {
 	AudioInfo = Audio_Info;
 	AUDIO_Init(NULL);
+	if(ring_wait == LWP_TQUEUE_NULL) LWP_InitQueue(&ring_wait);
+	DCFlushRange(silence, CHUNK_MAX);
+	AUDIO_RegisterDMACallback(done_playing);
 	return TRUE;
 }
 
 EXPORT void CALL RomOpen()
 {
-#ifdef THREADED_AUDIO
-	// Create our semaphores and start/resume the audio thread; reset the buffer index
-	LWP_SemInit(&buffer_full, 0, NUM_BUFFERS);
-	LWP_SemInit(&buffer_empty, NUM_BUFFERS, NUM_BUFFERS);
-	LWP_SemInit(&audio_free, 0, 1);
-	LWP_SemInit(&first_audio, 0, 1);
-	thread_running = 0;
-	LWP_CreateThread(&audio_thread, (void*)play_buffer, NULL, audio_stack, AUDIO_STACK_SIZE, AUDIO_PRIORITY);
-	AUDIO_RegisterDMACallback(done_playing);
-	thread_buffer = which_buffer = 0;
-	audio_paused = 1;
-#endif
+	unsigned int level;
+	// Start with an empty ring and no history to interpolate from
+	_CPU_ISR_Disable(level);
+	stop_dma();
+	ring_write = ring_queue = ring_read = 0;
+	_CPU_ISR_Restore(level);
+	chunk_offset = 0;
+	resample_pos = 0x10000;
+	resample_last[0] = resample_last[1] = 0;
+	fill_avg = 0;
 }
 
 EXPORT void CALL
 RomClosed( void )
 {
-#ifdef THREADED_AUDIO
-	// Destroy semaphores and suspend the thread so audio can't play
-	if(!thread_running) LWP_SemPost(first_audio);
-	thread_running = 0;
-	LWP_SemDestroy(buffer_full);
-	LWP_SemDestroy(buffer_empty);
-	LWP_SemDestroy(audio_free);
-	LWP_SemDestroy(first_audio);
-	LWP_JoinThread(audio_thread, NULL);
-	audio_paused = 0;
-#endif
-	AUDIO_StopDMA(); // So we don't have a buzzing sound when we exit the game
+	unsigned int level;
+	// So we don't have a buzzing sound when we exit the game
+	_CPU_ISR_Disable(level);
+	stop_dma();
+	_CPU_ISR_Restore(level);
 }
 
 EXPORT void CALL
@@ -364,24 +414,17 @@ ProcessAlist( void )
 }
 
 void pauseAudio(void){
-#ifdef THREADED_AUDIO
-	// We just grab the audio_free 'lock' and don't let go
-	//   when we have this lock, audio_thread must be waiting
-	if(audioEnabled){
-		LWP_SemWait(audio_free);
-		audio_paused = 1;
-	}
-#endif
-	AUDIO_StopDMA();
+	unsigned int level;
+	// What was playing is dropped, anything else waits for resumeAudio
+	_CPU_ISR_Disable(level);
+	stop_dma();
+	_CPU_ISR_Restore(level);
 }
 
 void resumeAudio(void){
-#ifdef THREADED_AUDIO
-	if(audio_paused && audioEnabled){
-		// When we're want the audio to resume, release the 'lock'
-		LWP_SemPost(audio_free);
-		audio_paused = 0;
-	}
-#endif
+	unsigned int level;
+	if(!audioEnabled) return;
+	_CPU_ISR_Disable(level);
+	start_dma();
+	_CPU_ISR_Restore(level);
 }
-
@@ -0,0 +1,308 @@
+/**
+ * Wii64 - Save-Journal.c
+ *
+ * Background write-back of native saves through an append-only journal
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include "../main/rom.h"
+#include "../fileBrowser/fileBrowser.h"
+#include "../fileBrowser/fileBrowser-libfat.h"
+#include "Saves.h"
+
+/* While a game runs, the blocks of save memory it writes are marked dirty
+ * and a low priority thread appends them to <game>.jnl every second.
+ * Each record is a header (magic, type, offset, length, adler32) followed
+ * by the data, so a record torn by a crash is simply where replay stops.
+ * Once the journal grows past JOURNAL_COMPACT the save files themselves
+ * are rewritten and the journal emptied.
+ *
+ * The thread journals from a shadow copy which it keeps in step with
+ * what it has written, and the save files are rewritten from that same
+ * copy.  So any byte a compaction changes is also in the journal with
+ * its new value, and replaying the journal over a save file cut short
+ * by a crash still gives the state that was last journaled.
+ *
+ * Only SD and USB saves are journaled, memory cards are written whole
+ * when the game is saved as before.
+ */
+
+#define JOURNAL_MAGIC    0x534A4E4C // "SJNL"
+#define JOURNAL_HEADER   20
+#define JOURNAL_BLOCK    128        // flashram writes a block at a time
+#define JOURNAL_MAX_SIZE 0x20000
+#define JOURNAL_BLOCKS   (JOURNAL_MAX_SIZE / JOURNAL_BLOCK)
+#define JOURNAL_COMPACT  (64*1024)
+#define JOURNAL_PERIOD   1000000    // microseconds between flushes
+#define JOURNAL_PRIORITY 50         // Below the emulation thread: only uses idle time
+
+static const char* saveExt[SAVE_TYPES] = { "eep", "mpk", "sra", "fla" };
+
+static struct {
+	unsigned char* mem;
+	unsigned int   size;
+	unsigned char* shadow; // as of the last flush, allocated when first written
+	unsigned char  dirty[JOURNAL_BLOCKS];
+} saves[SAVE_TYPES];
+
+static char journalPath[FILE_BROWSER_MAX_PATH_LEN];
+static char savePath[FILE_BROWSER_MAX_PATH_LEN];
+static unsigned int journalBytes;
+static volatile int journalActive, journalRunning, journalDirty;
+static lwp_t journalThread = LWP_THREAD_NULL;
+static mutex_t journalLock;
+
+static void put_be32(unsigned char* p, unsigned int v){
+	p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static unsigned int get_be32(unsigned char* p){
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void save_filename(char* name, int type){
+	sprintf(name, "%s/%s%s.%s", savePath, ROM_SETTINGS.goodname,
+	        saveregionstr(), saveExt[type]);
+}
+
+static int append_record(FILE* f, int type, unsigned int offset, unsigned int length){
+	unsigned char header[JOURNAL_HEADER];
+	unsigned char* data = saves[type].shadow + offset;
+	put_be32(header,    JOURNAL_MAGIC);
+	put_be32(header+4,  type);
+	put_be32(header+8,  offset);
+	put_be32(header+12, length);
+	put_be32(header+16, adler32(adler32(0, NULL, 0), data, length));
+	if(fwrite(header, 1, JOURNAL_HEADER, f) != JOURNAL_HEADER ||
+	   fwrite(data, 1, length, f) != length)
+		return 0;
+	journalBytes += JOURNAL_HEADER + length;
+	return 1;
+}
+
+// Rewrites the save files from the shadows and empties the journal
+static void compact(void){
+	char name[FILE_BROWSER_MAX_PATH_LEN+16];
+	FILE* f;
+	int type, ok = 1;
+
+	for(type=0; type<SAVE_TYPES; ++type){
+		if(!saves[type].shadow) continue;
+		save_filename(name, type);
+		// In place where possible, so a crash can't leave it shorter
+		f = fopen(name, "r+b");
+		if(!f) f = fopen(name, "wb");
+		if(!f || fwrite(saves[type].shadow, 1, saves[type].size, f) != saves[type].size)
+			ok = 0;
+		if(f && fclose(f)) ok = 0;
+	}
+	// Keep the journal if any save file couldn't be written
+	if(!ok) return;
+
+	f = fopen(journalPath, "wb");
+	if(f){
+		fclose(f);
+		journalBytes = 0;
+	}
+}
+
+// Appends every dirty block to the journal
+static void flush(void){
+	FILE* f = NULL;
+	int type, block, ok = 1;
+
+	journalDirty = 0;
+	for(type=0; type<SAVE_TYPES; ++type){
+		unsigned char* dirty = saves[type].dirty;
+		int num_blocks = saves[type].size / JOURNAL_BLOCK;
+		if(!saves[type].mem) continue;
+
+		for(block=0; block<num_blocks; ++block){
+			int start = block;
+			if(!dirty[block]) continue;
+
+			if(!saves[type].shadow){
+				saves[type].shadow = malloc(saves[type].size);
+				if(!saves[type].shadow){
+					journalDirty = 1;
+					break;
+				}
+				memcpy(saves[type].shadow, saves[type].mem, saves[type].size);
+			}
+			if(!f && !(f = fopen(journalPath, "ab"))){
+				journalDirty = 1;
+				return;
+			}
+
+			// Runs of dirty blocks go into one record
+			while(block < num_blocks && dirty[block]){
+				dirty[block] = 0;
+				memcpy(saves[type].shadow + block*JOURNAL_BLOCK,
+				       saves[type].mem + block*JOURNAL_BLOCK, JOURNAL_BLOCK);
+				++block;
+			}
+			if(ok && !append_record(f, type, start*JOURNAL_BLOCK,
+			                        (block - start)*JOURNAL_BLOCK))
+				ok = 0;
+			// Written again next time
+			if(!ok){
+				memset(dirty + start, 1, block - start);
+				journalDirty = 1;
+			}
+		}
+	}
+	if(f && fclose(f)) journalDirty = 1;
+
+	if(journalBytes > JOURNAL_COMPACT) compact();
+}
+
+static void* journal_thread(void* arg){
+	while(1){
+		usleep(JOURNAL_PERIOD);
+		if(!journalRunning || !journalDirty) continue;
+
+		LWP_MutexLock(journalLock);
+		if(journalRunning) flush();
+		LWP_MutexUnlock(journalLock);
+	}
+	return NULL;
+}
+
+// Applies the journal on top of the save files and sets journalBytes
+//   to its size, torn records and all
+//   returns the number of records replayed, or -1 if a type replayed
+//   couldn't get a shadow (so the journal can't be compacted yet)
+static int replay(void){
+	unsigned char header[JOURNAL_HEADER];
+	unsigned char* data = NULL;
+	int replayed = 0, no_shadow = 0;
+	FILE* f = fopen(journalPath, "rb");
+	if(!f) return 0;
+	fseek(f, 0, SEEK_END);
+	journalBytes = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	while(fread(header, 1, JOURNAL_HEADER, f) == JOURNAL_HEADER){
+		unsigned int type   = get_be32(header+4);
+		unsigned int offset = get_be32(header+8);
+		unsigned int length = get_be32(header+12);
+
+		if(get_be32(header) != JOURNAL_MAGIC || type >= SAVE_TYPES ||
+		   !saves[type].mem || offset > saves[type].size ||
+		   length > saves[type].size - offset)
+			break;
+		free(data);
+		if(!(data = malloc(length ? length : 1)) ||
+		   fread(data, 1, length, f) != length ||
+		   adler32(adler32(0, NULL, 0), data, length) != get_be32(header+16))
+			break;
+
+		memcpy(saves[type].mem + offset, data, length);
+		if(!saves[type].shadow && !(saves[type].shadow = malloc(saves[type].size)))
+			no_shadow = 1;
+		++replayed;
+	}
+	free(data);
+	fclose(f);
+
+	return no_shadow ? -1 : replayed;
+}
+
+void saveJournal_attach(int type, unsigned char* mem, unsigned int size){
+	// What's about to be loaded has to include everything journaled
+	if(journalActive) saveJournal_close();
+	saves[type].mem  = mem;
+	saves[type].size = size;
+}
+
+void saveJournal_written(int type, unsigned int offset, unsigned int length){
+	unsigned int block, last;
+	if(!journalActive || !length || offset >= saves[type].size) return;
+	if(length > saves[type].size - offset) length = saves[type].size - offset;
+
+	last = (offset + length - 1) / JOURNAL_BLOCK;
+	for(block = offset / JOURNAL_BLOCK; block <= last; ++block)
+		saves[type].dirty[block] = 1;
+	journalDirty = 1;
+}
+
+int saveJournal_open(fileBrowser_file* savepath){
+	int type, replayed;
+
+	saveJournal_close();
+	if(saveFile_writeFile != fileBrowser_libfat_writeFile) return 0;
+
+	if(journalThread == LWP_THREAD_NULL){
+		LWP_MutexInit(&journalLock, false);
+		LWP_CreateThread(&journalThread, journal_thread, NULL, NULL, 0, JOURNAL_PRIORITY);
+	}
+	pauseRemovalThread();
+	LWP_MutexLock(journalLock);
+	strcpy(savePath, savepath->name);
+	sprintf(journalPath, "%s/%s%s.jnl", savePath, ROM_SETTINGS.goodname, saveregionstr());
+	journalBytes = 0;
+	for(type=0; type<SAVE_TYPES; ++type)
+		memset(saves[type].dirty, 0, sizeof(saves[type].dirty));
+
+	// Bring the save files up to date, which also empties the journal
+	replayed = replay();
+	for(type=0; type<SAVE_TYPES; ++type)
+		if(saves[type].shadow)
+			memcpy(saves[type].shadow, saves[type].mem, saves[type].size);
+	// A torn record would hide anything appended after it
+	if(replayed >= 0 && journalBytes) compact();
+
+	journalActive = 1;
+	LWP_MutexUnlock(journalLock);
+	continueRemovalThread();
+	return replayed != 0;
+}
+
+void saveJournal_resume(void){
+	journalRunning = journalActive;
+}
+
+void saveJournal_pause(void){
+	journalRunning = 0;
+	if(!journalActive) return;
+	LWP_MutexLock(journalLock);
+	if(journalDirty) flush();
+	LWP_MutexUnlock(journalLock);
+}
+
+void saveJournal_close(void){
+	int type;
+	saveJournal_pause();
+	if(!journalActive) return;
+
+	pauseRemovalThread();
+	LWP_MutexLock(journalLock);
+	if(journalBytes) compact();
+	for(type=0; type<SAVE_TYPES; ++type){
+		free(saves[type].shadow);
+		saves[type].shadow = NULL;
+	}
+	journalActive = 0;
+	LWP_MutexUnlock(journalLock);
+	continueRemovalThread();
+}
@@ -50,5 +50,30 @@ int saveSram(fileBrowser_file* savepath);
 int loadFlashram(fileBrowser_file* savepath);
 int saveFlashram(fileBrowser_file* savepath);
 
+/* Save-Journal.c: while the game runs, anything it writes to its save
+     memory is appended to a journal next to the save files by a
+     background thread, which folds the journal back into the save files
+     now and then.  Only SD and USB saves are journaled. */
+#define SAVE_EEPROM   0
+#define SAVE_MEMPAK   1
+#define SAVE_SRAM     2
+#define SAVE_FLASHRAM 3
+#define SAVE_TYPES    4
+
+/* Called by the load functions with the memory they load into, which
+     first folds any journal still open into the save files */
+void saveJournal_attach(int type, unsigned char* mem, unsigned int size);
+// Called after the game writes to save memory
+void saveJournal_written(int type, unsigned int offset, unsigned int length);
+/* Starts journaling once the saves are loaded from savepath, first
+     replaying whatever a previous session left in the journal
+   - returns 1 if the journal had anything newer than the save files */
+int  saveJournal_open(fileBrowser_file* savepath);
+// Around running the game: pausing writes out everything pending
+void saveJournal_resume(void);
+void saveJournal_pause(void);
+// Folds the journal into the save files and stops journaling
+void saveJournal_close(void);
+
 #endif
 
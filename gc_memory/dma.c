@@ -35,6 +35,7 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 #include <malloc.h>
 #include "dma.h"
 #include "memory.h"
@@ -73,6 +74,7 @@ int loadSram(fileBrowser_file* savepath){
 	memcpy(&saveFile, savepath, sizeof(fileBrowser_file));
 	memset(&saveFile.name[0],0,FILE_BROWSER_MAX_PATH_LEN);
 	sprintf((char*)saveFile.name,"%s/%s%s.sra",savepath->name,ROM_SETTINGS.goodname,saveregionstr());
+	saveJournal_attach(SAVE_SRAM, sram, 0x8000);
 
 	if(saveFile_readFile(&saveFile, &i, 4) == 4){ //file exists
 		saveFile.offset = 0;
@@ -105,10 +107,40 @@ int saveSram(fileBrowser_file* savepath){
 	return 1;
 }
 
-void dma_pi_read()
+/* Only the unaligned head and tail bytes need the per-byte swizzle,
+   the span in between has the same layout on both sides so it is
+   moved a word at a time by memcpy.
+ */
+void dma_copy(unsigned char* dst, unsigned int dst_off,
+              unsigned char* src, unsigned int src_off, unsigned int length)
 {
-   int i;
+#if S8 == 0
+   // No swizzle on big endian: memory is laid out just like the N64's
+   memcpy(dst + dst_off, src + src_off, length);
+#else
+   unsigned int span;
+   if ((dst_off ^ src_off) & 3)
+     {
+	// The words don't line up, every byte has to be swizzled
+	while (length--)
+	  dst[(dst_off++)^S8] = src[(src_off++)^S8];
+	return;
+     }
+   while ((dst_off & 3) && length)
+     {
+	dst[(dst_off++)^S8] = src[(src_off++)^S8];
+	length--;
+     }
+   span = length & ~3;
+   memcpy(dst + dst_off, src + src_off, span);
+   dst_off += span; src_off += span; length -= span;
+   while (length--)
+     dst[(dst_off++)^S8] = src[(src_off++)^S8];
+#endif
+}
 
+void dma_pi_read()
+{
    if (pi_register.pi_cart_addr_reg >= 0x08000000 &&
        pi_register.pi_cart_addr_reg < 0x08010000)
      {
@@ -117,9 +149,11 @@ void dma_pi_read()
 
 	     sramWritten = TRUE;
 
-	     for (i=0; i<(pi_register.pi_rd_len_reg & 0xFFFFFF)+1; i++)
-	       sram[((pi_register.pi_cart_addr_reg-0x08000000)+i)^S8]=
-	       ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg+i)^S8];
+	     dma_copy(sram, pi_register.pi_cart_addr_reg-0x08000000,
+	              (unsigned char*)rdram, pi_register.pi_dram_addr_reg,
+	              (pi_register.pi_rd_len_reg & 0xFFFFFF)+1);
+	     saveJournal_written(SAVE_SRAM, pi_register.pi_cart_addr_reg-0x08000000,
+	                         (pi_register.pi_rd_len_reg & 0xFFFFFF)+1);
 
 	     use_flashram = -1;
 	  }
@@ -147,9 +181,14 @@ void dma_pi_write()
 	     if (use_flashram != 1)
 	       {
 
-		  for (i=0; i<(pi_register.pi_wr_len_reg & 0xFFFFFF)+1; i++)
-		    ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg+i)^S8]=
-		    sram[(((pi_register.pi_cart_addr_reg-0x08000000)&0xFFFF)+i)^S8];
+		  dma_copy((unsigned char*)rdram, pi_register.pi_dram_addr_reg,
+		           sram, (pi_register.pi_cart_addr_reg-0x08000000)&0xFFFF,
+		           (pi_register.pi_wr_len_reg & 0xFFFFFF)+1);
+		  rdram_page_written(pi_register.pi_dram_addr_reg & MEMMASK,
+		                     (pi_register.pi_wr_len_reg & 0xFFFFFF)+1);
+		  if(!interpcore)
+		    invalid_code_check_write(pi_register.pi_dram_addr_reg & MEMMASK,
+		                             (pi_register.pi_wr_len_reg & 0xFFFFFF)+1);
 		  use_flashram = -1;
 	       }
 	     else
@@ -192,60 +231,18 @@ void dma_pi_write()
 	return;
      }
 
-   if(!interpcore)
-     {
-     	// FIXME: This must be adjusted for GC
-     	ROMCache_read((unsigned int*)((char*)rdram + ((unsigned int)(pi_register.pi_dram_addr_reg)^S8)), ((pi_register.pi_cart_addr_reg-0x10000000)&0x3FFFFFF)^S8, longueur);
-	for (i=0; i<longueur; i++)
-	  {
-	     unsigned long rdram_address1 = pi_register.pi_dram_addr_reg+i+0x80000000;
-	     unsigned long rdram_address2 = pi_register.pi_dram_addr_reg+i+0xa0000000;
+   /*printf("DMA transfer from cart address: %08x\n"
+          "To RDRAM address: %08x of length %u\n",
+          ((pi_register.pi_cart_addr_reg-0x10000000)&0x3FFFFFF)^S8,
+          ((unsigned int)(pi_register.pi_dram_addr_reg)^S8),
+          longueur);*/
+   ROMCache_read((unsigned int*)((char*)rdram + ((unsigned int)(pi_register.pi_dram_addr_reg)^S8)),
+                 (((pi_register.pi_cart_addr_reg-0x10000000)&0x3FFFFFF))^S8, longueur);
 
-	     //((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg+i)^S8]=
-	     //  rom[(((pi_register.pi_cart_addr_reg-0x10000000)&0x3FFFFFF)+i)^S8];
-	     //ROMCache_read((char*)rdram + (pi_register.pi_dram_addr_reg+i)^S8, (((pi_register.pi_cart_addr_reg-0x10000000)&0x3FFFFFF)+i)^S8, 1);
-
-#if 0
-	     if(!invalid_code_get(rdram_address1>>12))
-    		 invalid_code_set(rdram_address1>>12, 1);
-
-	     if(!invalid_code_get(rdram_address2>>12))
-    		 invalid_code_set(rdram_address2>>12, 1);
-#else
-	     PowerPC_func* func;
-	     PowerPC_block* temp_block = blocks_get(rdram_address1>>12);
-	     if(temp_block){
-	     func = find_func(&temp_block->funcs, rdram_address1);
-         if(!invalid_code_get(rdram_address1>>12))
-	       //if(blocks[rdram_address1>>12]->code_addr[(rdram_address1&0xFFF)/4])
-        	 if(func) RecompCache_Free(func->start_addr);//invalid_code_set(rdram_address1>>12, 1);
-	     }
-
-	     temp_block = blocks_get(rdram_address2>>12);
-	     if(temp_block){
-         func = find_func(&temp_block->funcs, rdram_address2);
-	     if(!invalid_code_get(rdram_address2>>12))
-	       //if(blocks[rdram_address2>>12]->code_addr[(rdram_address2&0xFFF)/4])
-	    	 if(func) RecompCache_Free(func->start_addr);//invalid_code_set(rdram_address2>>12, 1);
-	     }
-#endif
-	  }
-     }
-   else
-     {
-     	/*printf("DMA transfer from cart address: %08x\n"
-     	       "To RDRAM address: %08x of length %u\n",
-     	       ((pi_register.pi_cart_addr_reg-0x10000000)&0x3FFFFFF)^S8,
-     	       ((unsigned int)(pi_register.pi_dram_addr_reg)^S8),
-     	       longueur);*/
-	ROMCache_read((unsigned int*)((char*)rdram + ((unsigned int)(pi_register.pi_dram_addr_reg)^S8)),
-	              (((pi_register.pi_cart_addr_reg-0x10000000)&0x3FFFFFF))^S8, longueur);
-	/*for (i=0; i<longueur; i++)
-	  {
-	     ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg+i)^S8]=
-	       rom[(((pi_register.pi_cart_addr_reg-0x10000000)&0x3FFFFFF)+i)^S8];
-	  }*/
-     }
+   rdram_page_written(pi_register.pi_dram_addr_reg & MEMMASK, longueur);
+   // Only throw out the recompiled code that was actually overwritten
+   if(!interpcore)
+     invalid_code_check_write(pi_register.pi_dram_addr_reg & MEMMASK, longueur);
 
    /*for (i=0; i<=((longueur+0x800)>>12); i++)
      invalid_code[(((pi_register.pi_dram_addr_reg&0xFFFFFF)|0x80000000)>>12)+i] = 1;*/
@@ -263,6 +260,7 @@ void dma_pi_write()
 #else
 	     rdram[0x318/4] = 0x400000;
 #endif
+	     rdram_page_written(0x318, 4);
 	     break;
 	   case 5:
 #ifdef USE_EXPANSION
@@ -270,6 +268,7 @@ void dma_pi_write()
 #else
 	     rdram[0x3F0/4] = 0x400000;
 #endif
+	     rdram_page_written(0x3F0, 4);
 	     break;
 	  }
 	  /* DK64 Fix */
@@ -285,36 +284,25 @@ void dma_pi_write()
 
 void dma_sp_write()
 {
-   int i;
-   if ((sp_register.sp_mem_addr_reg & 0x1000) > 0)
-     {
-	for (i=0; i<((sp_register.sp_rd_len_reg & 0xFFF)+1); i++)
-	  ((unsigned char *)(SP_IMEM))[((sp_register.sp_mem_addr_reg & 0xFFF)+i)^S8]=
-	  ((unsigned char *)(rdram))[((sp_register.sp_dram_addr_reg & 0xFFFFFF)+i)^S8];
-     }
-   else
-     {
-	for (i=0; i<((sp_register.sp_rd_len_reg & 0xFFF)+1); i++)
-	  ((unsigned char *)(SP_DMEM))[((sp_register.sp_mem_addr_reg & 0xFFF)+i)^S8]=
-	  ((unsigned char *)(rdram))[((sp_register.sp_dram_addr_reg & 0xFFFFFF)+i)^S8];
-     }
+   unsigned char* spmem = (sp_register.sp_mem_addr_reg & 0x1000) > 0 ?
+     (unsigned char *)(SP_IMEM) : (unsigned char *)(SP_DMEM);
+   dma_copy(spmem, sp_register.sp_mem_addr_reg & 0xFFF,
+            (unsigned char *)(rdram), sp_register.sp_dram_addr_reg & 0xFFFFFF,
+            (sp_register.sp_rd_len_reg & 0xFFF)+1);
 }
 
 void dma_sp_read()
 {
-   int i;
-   if ((sp_register.sp_mem_addr_reg & 0x1000) > 0)
-     {
-	for (i=0; i<((sp_register.sp_wr_len_reg & 0xFFF)+1); i++)
-	  ((unsigned char *)(rdram))[((sp_register.sp_dram_addr_reg & 0xFFFFFF)+i)^S8]=
-	  ((unsigned char *)(SP_IMEM))[((sp_register.sp_mem_addr_reg & 0xFFF)+i)^S8];
-     }
-   else
-     {
-	for (i=0; i<((sp_register.sp_wr_len_reg & 0xFFF)+1); i++)
-	  ((unsigned char *)(rdram))[((sp_register.sp_dram_addr_reg & 0xFFFFFF)+i)^S8]=
-	  ((unsigned char *)(SP_DMEM))[((sp_register.sp_mem_addr_reg & 0xFFF)+i)^S8];
-     }
+   unsigned char* spmem = (sp_register.sp_mem_addr_reg & 0x1000) > 0 ?
+     (unsigned char *)(SP_IMEM) : (unsigned char *)(SP_DMEM);
+   dma_copy((unsigned char *)(rdram), sp_register.sp_dram_addr_reg & 0xFFFFFF,
+            spmem, sp_register.sp_mem_addr_reg & 0xFFF,
+            (sp_register.sp_wr_len_reg & 0xFFF)+1);
+   rdram_page_written(sp_register.sp_dram_addr_reg & 0xFFFFFF,
+                      (sp_register.sp_wr_len_reg & 0xFFF)+1);
+   if(!interpcore)
+     invalid_code_check_write(sp_register.sp_dram_addr_reg & 0xFFFFFF,
+                              (sp_register.sp_wr_len_reg & 0xFFF)+1);
 }
 
 void dma_si_write()
@@ -343,6 +331,9 @@ void dma_si_read()
    update_pif_read();
    for (i=0; i<(64/4); i++)
      rdram[si_register.si_dram_addr/4+i] = sl(PIF_RAM[i]);
+   rdram_page_written(si_register.si_dram_addr, 64);
+   if(!interpcore)
+     invalid_code_check_write(si_register.si_dram_addr, 64);
    update_count();
    add_interupt_event(SI_INT, /*0x100*/0x900);
 }
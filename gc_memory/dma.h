@@ -37,4 +37,8 @@ void dma_si_read();
 void dma_sp_write();
 void dma_sp_read();
 
+// Copy between two word-swizzled buffers (offsets are N64 byte offsets)
+void dma_copy(unsigned char* dst, unsigned int dst_off,
+              unsigned char* src, unsigned int src_off, unsigned int length);
+
 #endif
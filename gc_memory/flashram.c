@@ -38,7 +38,9 @@
 #endif
 
 #include "memory.h"
+#include "dma.h"
 #include "../r4300/r4300.h"
+#include "../r4300/Invalid_Code.h"
 #include "../main/guifuncs.h"
 #include "../fileBrowser/fileBrowser.h"
 
@@ -76,6 +78,7 @@ int loadFlashram(fileBrowser_file* savepath){
 	memcpy(&saveFile, savepath, sizeof(fileBrowser_file));
 	memset(&saveFile.name[0],0,FILE_BROWSER_MAX_PATH_LEN);
 	sprintf((char*)saveFile.name,"%s/%s%s.fla",savepath->name,ROM_SETTINGS.goodname,saveregionstr());
+	saveJournal_attach(SAVE_FLASHRAM, flashram, 0x20000);
 
 	if(saveFile_readFile(&saveFile, &i, 4) == 4) {  //file exists
 		saveFile.offset = 0;
@@ -170,18 +173,16 @@ void flashram_command(unsigned long command)
 
 		  for (i=erase_offset; i<(erase_offset+128); i++)
 		    flashram[i^S8] = 0xff;
-
+		  saveJournal_written(SAVE_FLASHRAM, erase_offset, 128);
 	       }
 	     break;
 	   case WRITE_MODE:
 	       {
-	       	  	int i;
-		  		flashramWritten = TRUE;
-
-		  for (i=0; i<128; i++)
-		    flashram[(erase_offset+i)^S8]=
-		    ((unsigned char*)rdram)[(write_pointer+i)^S8];
+		  flashramWritten = TRUE;
 
+		  dma_copy(flashram, erase_offset,
+		           (unsigned char*)rdram, write_pointer, 128);
+		  saveJournal_written(SAVE_FLASHRAM, erase_offset, 128);
 	       }
 	     break;
 	   case STATUS_MODE:
@@ -208,19 +209,20 @@ void flashram_command(unsigned long command)
 
 void dma_read_flashram()
 {
-   int i;
-
    switch(mode)
      {
       case STATUS_MODE:
 	rdram[pi_register.pi_dram_addr_reg/4] = (unsigned long)(status >> 32);
 	rdram[pi_register.pi_dram_addr_reg/4+1] = (unsigned long)(status);
+	rdram_page_written(pi_register.pi_dram_addr_reg & 0x7FFFFF, 8);
 	break;
       case READ_MODE:
 
-	for (i=0; i<(pi_register.pi_wr_len_reg & 0x0FFFFFF)+1; i++)
-	  ((unsigned char*)rdram)[(pi_register.pi_dram_addr_reg+i)^S8]=
-	  flashram[(((pi_register.pi_cart_addr_reg-0x08000000)&0xFFFF)*2+i)^S8];
+	dma_copy((unsigned char*)rdram, pi_register.pi_dram_addr_reg,
+	         flashram, ((pi_register.pi_cart_addr_reg-0x08000000)&0xFFFF)*2,
+	         (pi_register.pi_wr_len_reg & 0x0FFFFFF)+1);
+	rdram_page_written(pi_register.pi_dram_addr_reg & 0x7FFFFF,
+	                   (pi_register.pi_wr_len_reg & 0x0FFFFFF)+1);
 	break;
       default:
 	printf("unknown dma_read_flashram:%x\n", mode);
@@ -52,6 +52,8 @@
 #include "flashram.h"
 #include "../main/plugin.h"
 #include "../main/guifuncs.h"
+#include "../main/runahead.h"
+#include "../main/wii64config.h"
 #include "../gui/DEBUG.h"
 #include <assert.h>
 
@@ -84,6 +86,9 @@ unsigned char *SP_IMEMb = (unsigned char*)(SP_DMEM+0x1000/4);
 unsigned long PIF_RAM[0x40/4];
 unsigned char *PIF_RAMb = (unsigned char *)(PIF_RAM);
 
+// 0 runs audio tasks as soon as they're started, see rsp_hle/main.c
+char audioTaskDelay = AUDIOTASKDELAY_SYNC;
+
 // address : address of the read/write operation being done
 unsigned long address = 0;
 // *address_low = the lower 16 bit of the address :
@@ -882,7 +887,8 @@ void update_SP()
 	     sp_register.sp_status_reg &= ~0x303;
 	     update_count();
 	     //add_interupt_event(SP_INT, 500);
-	     add_interupt_event(SP_INT, 4000);
+	     // The delay comes on top of the synchronous path's, never instead of it
+	     add_interupt_event(SP_INT, 4000 + audioTaskDelay*1000);
 	  }
 	else
 	  {
@@ -1149,22 +1155,26 @@ void read_rdramFBd()
 void write_rdram()
 {
    *((unsigned long *)(rdramb + (address & MEMMASK))) = word;
+   ++rdram_page_gen[(address & MEMMASK)>>12];
 }
 
 void write_rdramb()
 {
    *((rdramb + ((address & MEMMASK)^S8))) = byte;
+   ++rdram_page_gen[(address & MEMMASK)>>12];
 }
 
 void write_rdramh()
 {
    *(unsigned short *)((rdramb + ((address & MEMMASK)^S16))) = hword;
+   ++rdram_page_gen[(address & MEMMASK)>>12];
 }
 
 void write_rdramd()
 {
    *((unsigned long *)(rdramb + (address & MEMMASK))) = dword >> 32;
    *((unsigned long *)(rdramb + (address & MEMMASK) + 4 )) = dword & 0xFFFFFFFF;
+   ++rdram_page_gen[(address & MEMMASK)>>12];
 }
 
 void write_rdramFB()
@@ -2231,8 +2241,10 @@ void write_ai()
      {
       case 0x4:
 	ai_register.ai_len = word;
+	// The DMA plays what the audio task made
+	joinAudioTask_RSP();
 #ifndef VCR_SUPPORT
-	aiLenChanged();
+	if (RUNAHEAD_PLAY_AUDIO) aiLenChanged();
 #else
 	VCR_aiLenChanged();
 #endif
@@ -2339,8 +2351,10 @@ void write_aib()
 	*((unsigned char*)&temp
 	  + ((*address_low&3)^S8) ) = byte;
 	ai_register.ai_len = temp;
+	// The DMA plays what the audio task made
+	joinAudioTask_RSP();
 #ifndef VCR_SUPPORT
-	aiLenChanged();
+	if (RUNAHEAD_PLAY_AUDIO) aiLenChanged();
 #else
 	VCR_aiLenChanged();
 #endif
@@ -2447,8 +2461,10 @@ void write_aih()
 	*((unsigned short*)((unsigned char*)&temp
 			    + ((*address_low&3)^S16) )) = hword;
 	ai_register.ai_len = temp;
+	// The DMA plays what the audio task made
+	joinAudioTask_RSP();
 #ifndef VCR_SUPPORT
-	aiLenChanged();
+	if (RUNAHEAD_PLAY_AUDIO) aiLenChanged();
 #else
 	VCR_aiLenChanged();
 #endif
@@ -2547,8 +2563,10 @@ void write_aid()
       case 0x0:
 	ai_register.ai_dram_addr = dword >> 32;
 	ai_register.ai_len = dword & 0xFFFFFFFF;
+	// The DMA plays what the audio task made
+	joinAudioTask_RSP();
 #ifndef VCR_SUPPORT
-	aiLenChanged();
+	if (RUNAHEAD_PLAY_AUDIO) aiLenChanged();
 #else
 	VCR_aiLenChanged();
 #endif
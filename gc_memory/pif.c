@@ -77,6 +77,7 @@ int loadEeprom(fileBrowser_file* savepath){
 	memcpy(&saveFile, savepath, sizeof(fileBrowser_file));
 	memset(&saveFile.name[0],0,FILE_BROWSER_MAX_PATH_LEN);
 	sprintf((char*)saveFile.name,"%s/%s%s.eep",savepath->name,ROM_SETTINGS.goodname,saveregionstr());
+	saveJournal_attach(SAVE_EEPROM, eeprom, 0x800);
 
 	if(saveFile_readFile(&saveFile, &i, 4) == 4) {  //file exists
 		saveFile.offset = 0;
@@ -160,6 +161,7 @@ void EepromCommand(BYTE *Command)
 	  {
 	     eepromWritten = TRUE;
 	     memcpy(eeprom + Command[3]*8, &Command[4], 8);
+	     saveJournal_written(SAVE_EEPROM, Command[3]*8, 8);
 	  }
 	break;
 /*      default:
@@ -227,6 +229,7 @@ int loadMempak(fileBrowser_file* savepath){
 	memcpy(&saveFile, savepath, sizeof(fileBrowser_file));
 	memset(&saveFile.name[0],0,FILE_BROWSER_MAX_PATH_LEN);
 	sprintf((char*)saveFile.name,"%s/%s%s.mpk",savepath->name,ROM_SETTINGS.goodname,saveregionstr());
+	saveJournal_attach(SAVE_MEMPAK, (unsigned char*)mempack, 0x8000 * 4);
 
 	if(saveFile_readFile(&saveFile, &i, 4) == 4) {  //file exists
 		saveFile.offset = 0;
@@ -382,6 +385,7 @@ void internal_ControllerCommand(int Control, BYTE *Command)
 			      {
 	                 mempakWritten = TRUE;
 					 memcpy(&mempack[Control][address], &Command[5], 0x20);
+					 saveJournal_written(SAVE_MEMPAK, Control*0x8000 + address, 0x20);
 				 	 Command[0x25] = mempack_crc(&Command[5]);
 			 }
 		    }
@@ -19,6 +19,10 @@
 
 unsigned long CRCTable[ 256 ];
 
+// CRCSlice[k][i] is the CRC of byte i followed by k+1 zero bytes, so 8
+// bytes can be folded in with 8 independent lookups
+static unsigned long CRCSlice[ 7 ][ 256 ];
+
 DWORD Reflect( DWORD ref, char ch )
 {
      DWORD value = 0;
@@ -46,6 +50,16 @@ void CRC_BuildTable()
         
         CRCTable[i] = Reflect( crc, 32 );
     }
+
+    for (int i = 0; i <= 255; i++)
+	{
+        crc = CRCTable[i];
+        for (int k = 0; k < 7; k++)
+		{
+			crc = (crc >> 8) ^ CRCTable[crc & 0xFF];
+			CRCSlice[k][i] = crc;
+		}
+    }
 }
 
 DWORD CRC_Calculate( DWORD crc, void *buffer, DWORD count )
@@ -54,6 +68,24 @@ DWORD CRC_Calculate( DWORD crc, void *buffer, DWORD count )
 	DWORD orig = crc;
 
     p = (BYTE*) buffer;
+
+	// Two words at a time.  A word's low byte comes first either way:
+	// on big endian that's the ^3 swizzle below, so the CRC is the same.
+	if (!((unsigned long)p & 3))
+	{
+		while (count >= 8)
+		{
+			DWORD one = *(unsigned int*)p ^ crc;
+			DWORD two = *(unsigned int*)(p + 4);
+			crc = CRCSlice[6][one & 0xFF] ^ CRCSlice[5][(one >> 8) & 0xFF] ^
+			      CRCSlice[4][(one >> 16) & 0xFF] ^ CRCSlice[3][one >> 24] ^
+			      CRCSlice[2][two & 0xFF] ^ CRCSlice[1][(two >> 8) & 0xFF] ^
+			      CRCSlice[0][(two >> 16) & 0xFF] ^ CRCTable[two >> 24];
+			p += 8;
+			count -= 8;
+		}
+	}
+
 	while (count--) 
 #ifndef _BIG_ENDIAN
 		crc = (crc >> 8) ^ CRCTable[(crc & 0xFF) ^ *p++];
@@ -33,6 +33,9 @@ FrameBufferInfo frameBuffer;
 
 #ifdef __GX__
 extern heap_cntrl* GXtexCache;
+extern "C" {
+#include "../r4300/Invalid_Code.h"
+}
 #endif //__GX__
 
 void FrameBuffer_Init()
@@ -220,6 +223,9 @@ void FrameBuffer_SaveBuffer( u32 address, u16 size, u16 width, u16 height )
 #endif // __GX__
 
 			*(u32*)&RDRAM[current->startAddress] = current->startAddress;
+#ifdef __GX__
+			rdram_page_written(current->startAddress, 4);
+#endif // __GX__
 
 			current->changed = TRUE;
 
@@ -331,6 +337,9 @@ void FrameBuffer_SaveBuffer( u32 address, u16 size, u16 width, u16 height )
 #endif // __GX__
 
 	*(u32*)&RDRAM[current->startAddress] = current->startAddress;
+#ifdef __GX__
+	rdram_page_written(current->startAddress, 4);
+#endif // __GX__
 
 	current->changed = TRUE;
 
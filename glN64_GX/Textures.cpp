@@ -49,6 +49,86 @@ TextureCache	cache;
 heap_cntrl* GXtexCache;
 #endif //__GX__
 
+// The last CRC taken for each texture, which still holds if nothing has
+// been loaded into TMEM since and it's for the same tile and size
+static struct
+{
+	BOOL valid;
+	u32 tmemLoads, tmem, line, size, format, palette, width, height;
+	u32 crc;
+} lastCRC[2];
+
+// An index of the textures TextureCache_Update made, by what it matches
+// them on, so a bind doesn't walk the whole list.  It's open addressing
+// with linear probing, and removing an entry shifts back the ones after
+// it that hashed before the hole, so there are no tombstones to skip.
+// The list still owns the textures and decides what's evicted.
+#define TEXTURE_INDEX_BITS	13
+#define TEXTURE_INDEX_SIZE	(1 << TEXTURE_INDEX_BITS)
+#define TEXTURE_INDEX_MASK	(TEXTURE_INDEX_SIZE - 1)
+static CachedTexture *textureIndex[TEXTURE_INDEX_SIZE];
+static u32 textureIndexCount;
+
+inline u32 TextureCache_Hash( u32 crc, u32 width, u32 height, u32 clampWidth, u32 clampHeight,
+							  u32 maskS, u32 maskT, u32 format, u32 size )
+{
+	u32 h = crc;
+	h = (h ^ ((width << 16) | height)) * 0x9E3779B1;
+	h = (h ^ ((clampWidth << 16) | clampHeight)) * 0x9E3779B1;
+	h = (h ^ ((maskS << 24) | (maskT << 16) | (format << 8) | size)) * 0x9E3779B1;
+	return h >> (32 - TEXTURE_INDEX_BITS);
+}
+
+inline u32 TextureCache_HashTexture( CachedTexture *texture )
+{
+	return TextureCache_Hash( texture->crc, texture->width, texture->height,
+							  texture->clampWidth, texture->clampHeight,
+							  texture->maskS, texture->maskT, texture->format, texture->size );
+}
+
+static void TextureCache_Index( CachedTexture *texture )
+{
+	// Kept under 3/4 full, past that textures just aren't found again
+	// (only possible without GX_MAX_TEXTURES)
+	if (textureIndexCount >= TEXTURE_INDEX_SIZE * 3 / 4)
+		return;
+
+	u32 i = TextureCache_HashTexture( texture );
+	while (textureIndex[i])
+		i = (i + 1) & TEXTURE_INDEX_MASK;
+
+	textureIndex[i] = texture;
+	textureIndexCount++;
+}
+
+static void TextureCache_Unindex( CachedTexture *texture )
+{
+	u32 i = TextureCache_HashTexture( texture ), j, k;
+
+	while (textureIndex[i] != texture)
+	{
+		// Not one TextureCache_Update made
+		if (!textureIndex[i])
+			return;
+		i = (i + 1) & TEXTURE_INDEX_MASK;
+	}
+
+	j = i;
+	while (textureIndex[j = (j + 1) & TEXTURE_INDEX_MASK])
+	{
+		// Entries that hash to (i, j] are still reachable with i empty
+		k = TextureCache_HashTexture( textureIndex[j] );
+		if ((i < j) ? (k <= i || k > j) : (k <= i && k > j))
+		{
+			textureIndex[i] = textureIndex[j];
+			i = j;
+		}
+	}
+
+	textureIndex[i] = NULL;
+	textureIndexCount--;
+}
+
 typedef u32 (*GetTexelFunc)( u64 *src, u16 x, u16 i, u8 palette );
 
 inline u32 GetNone( u64 *src, u16 x, u16 i, u8 palette )
@@ -390,6 +470,9 @@ void TextureCache_Init()
 	cache.cachedBytes = 0;
 	cache.enable2xSaI = OGL.enable2xSaI;
 	cache.bitDepth = OGL.textureBitDepth;
+	lastCRC[0].valid = lastCRC[1].valid = FALSE;
+	memset( textureIndex, 0, sizeof( textureIndex ) );
+	textureIndexCount = 0;
 
 #ifdef __GX__
 	//Init texture cache heap if not yet inited
@@ -539,6 +622,8 @@ void TextureCache_RemoveBottom()
 	if (cache.bottom == cache.top)
 		cache.top = NULL;
 
+	TextureCache_Unindex( cache.bottom );
+
 #ifdef __GX__
 	if( cache.bottom->GXtexture != NULL )
 //		free( cache.bottom->GXtexture );
@@ -561,6 +646,8 @@ void TextureCache_Remove( CachedTexture *texture )
 		FrameBuffer_RemoveBuffer( texture->address );
 #endif //__GX__
 
+	TextureCache_Unindex( texture );
+
 	if ((texture == cache.bottom) &&
 		(texture == cache.top))
 	{
@@ -1379,6 +1466,18 @@ u32 TextureCache_CalculateCRC( u32 t, u32 width, u32 height )
 	u32 crc;
 	u32 y, /*i,*/ bpl, lineBytes, line;
 	u64 *src;
+	gDPTile *tile = gSP.textureTile[t];
+
+	if (lastCRC[t].valid &&
+		(lastCRC[t].tmemLoads == gDP.tmemLoads) &&
+		(lastCRC[t].tmem == tile->tmem) &&
+		(lastCRC[t].line == tile->line) &&
+		(lastCRC[t].size == tile->size) &&
+		(lastCRC[t].format == tile->format) &&
+		(lastCRC[t].palette == tile->palette) &&
+		(lastCRC[t].width == width) &&
+		(lastCRC[t].height == height))
+		return lastCRC[t].crc;
 
 	src = (u64*)&TMEM[gSP.textureTile[t]->tmem];
 	bpl = width << gSP.textureTile[t]->size >> 1;
@@ -1403,6 +1502,17 @@ u32 TextureCache_CalculateCRC( u32 t, u32 width, u32 height )
 		else if (gSP.textureTile[t]->size == G_IM_SIZ_8b)
 			crc = CRC_Calculate( crc, &gDP.paletteCRC256, 4 );
 	}
+
+	lastCRC[t].valid = TRUE;
+	lastCRC[t].tmemLoads = gDP.tmemLoads;
+	lastCRC[t].tmem = tile->tmem;
+	lastCRC[t].line = tile->line;
+	lastCRC[t].size = tile->size;
+	lastCRC[t].format = tile->format;
+	lastCRC[t].palette = tile->palette;
+	lastCRC[t].width = width;
+	lastCRC[t].height = height;
+	lastCRC[t].crc = crc;
 	return crc;
 }
 
@@ -1579,7 +1689,7 @@ void TextureCache_Update( u32 t )
 {
 	CachedTexture *current;
 	//s32 i, j, k;
-	u32 crc, /*bpl, cacheNum,*/ maxTexels;
+	u32 i, crc, /*bpl, cacheNum,*/ maxTexels;
 	u32 tileWidth, maskWidth, loadWidth, lineWidth, clampWidth, height;
 	u32 tileHeight, maskHeight, loadHeight, lineHeight, clampHeight, width;
 
@@ -1726,9 +1836,12 @@ void TextureCache_Update( u32 t )
 //	if (!TextureCache_Verify())
 //		current = cache.top;
 
-	current = cache.top;
- 	while (current)
+	for (i = TextureCache_Hash( crc, width, height, clampWidth, clampHeight,
+								gSP.textureTile[t]->masks, gSP.textureTile[t]->maskt,
+								gSP.textureTile[t]->format, gSP.textureTile[t]->size );
+		 (current = textureIndex[i]) != NULL; i = (i + 1) & TEXTURE_INDEX_MASK)
   	{
+		cache.probes++;
 		if ((current->crc == crc) &&
 //			(current->address == gDP.textureImage.address) &&
 //			(current->palette == gSP.textureTile[t]->palette) &&
@@ -1756,8 +1869,6 @@ void TextureCache_Update( u32 t )
 			cache.hits++;
 			return;
 		}
-
-		current = current->lower;
 	}
 
 	cache.misses++;
@@ -1851,6 +1962,7 @@ void TextureCache_Update( u32 t )
 	else if (gSP.textureTile[t]->shiftt > 0)
 		cache.current[t]->shiftScaleT /= (f32)(1 << gSP.textureTile[t]->shiftt);
 
+	TextureCache_Index( cache.current[t] );
 	TextureCache_Load( cache.current[t] );
 	TextureCache_ActivateTexture( t, cache.current[t] );
 //	TextureCache_ActivateDummy( t );
@@ -71,7 +71,7 @@ struct TextureCache
 	u32				maxBytes;
 	u32				cachedBytes;
 	u32				numCached;
-	u32				hits, misses;
+	u32				hits, misses, probes;
 	GLuint			glNoiseNames[32];
 	//GLuint			glDummyName;
 	CachedTexture	*dummy;
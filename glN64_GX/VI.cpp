@@ -201,6 +201,9 @@ void VI_UpdateScreen()
 extern "C" {
 extern long long gettime();
 extern unsigned int diff_sec(long long start,long long end);
+#include "../main/runahead.h"
+extern char audioLatency;
+void audio_get_stats(unsigned int* fill_us, int* rate_ppm);
 };
 
 void VI_GX_init() {
@@ -232,21 +235,43 @@ void VI_GX_clearEFB(){
 extern timers Timers;
 
 void VI_GX_showFPS(){
-	static char caption[25];
+	static char caption[25], runAheadCaption[40], audioCaption[40];
+	int runAhead, audioRate, audioY;
+	unsigned int saveTime, restoreTime, frameTime, audioFill;
 
 	TimerUpdate();
 
 	sprintf(caption, "%.1f VI/s, %.1f FPS",Timers.vis,Timers.fps);
+
+	// What running ahead costs each frame, to help pick how far
+	runahead_get_stats(&runAhead, &saveTime, &restoreTime, &frameTime);
+	if(runAhead < 0)
+		sprintf(runAheadCaption, "Run-ahead: not enough memory");
+	else if(runAhead)
+		sprintf(runAheadCaption, "Run-ahead %d: %.1f ms/frame", runAhead, frameTime / 1000.0f);
+
+	// Whether the audio rate control is holding its target
+	audio_get_stats(&audioFill, &audioRate);
+	sprintf(audioCaption, "Audio: %.1f ms, rate %+.2f%%", audioFill / 1000.0f, audioRate / 10000.0f);
+	audioY = runAhead ? 85 : 60;
 	
 	GXColor fontColor = {150,255,150,255};
 #ifndef MENU_V2
 	write_font_init_GX(fontColor);
 	if(showFPSonScreen)
 		write_font(10,35,caption, 1.0);
+	if(showFPSonScreen && runAhead)
+		write_font(10,60,runAheadCaption, 1.0);
+	if(showFPSonScreen && audioLatency)
+		write_font(10,audioY,audioCaption, 1.0);
 #else
 	menu::IplFont::getInstance().drawInit(fontColor);
 	if(showFPSonScreen)
 		menu::IplFont::getInstance().drawString(10,35,caption, 1.0, false);
+	if(showFPSonScreen && runAhead)
+		menu::IplFont::getInstance().drawString(10,60,runAheadCaption, 1.0, false);
+	if(showFPSonScreen && audioLatency)
+		menu::IplFont::getInstance().drawString(10,audioY,audioCaption, 1.0, false);
 #endif
 
 	//reset swap table from GUI/DEBUG
@@ -440,6 +465,7 @@ void VI_GX_showDEBUG()
 
 #ifdef SHOW_DEBUG
 	extern int CntTriProj, CntTriProjW, CntTriOther, CntTriNear, CntTriPolyOffset;
+	extern "C" void ROMCache_get_stats(u32* hits, u32* misses, u32* evictions);
 #endif
 
 void VI_GX_showStats()
@@ -448,6 +474,9 @@ void VI_GX_showStats()
 	sprintf(txtbuffer,"texCache: %d bytes in %d cached textures; %d FB textures; %d max textures",cache.cachedBytes,cache.numCached,frameBuffer.numBuffers, GX_MAX_TEXTURES);
 	DEBUG_print(txtbuffer,DBG_CACHEINFO); 
 
+	sprintf(txtbuffer,"texCache: %d hits; %d misses; %d probes",cache.hits,cache.misses,cache.probes);
+	DEBUG_print(txtbuffer,DBG_TEXCACHEINFO);
+
 	sprintf(txtbuffer,"TriMatr: %d Proj; %d ProjW; %d Other; %d ProjWnear; %d PolyOff",CntTriProj,CntTriProjW,CntTriOther,CntTriNear,CntTriPolyOffset);
 	DEBUG_print(txtbuffer,DBG_CACHEINFO+1); 
 	CntTriProj = 0;
@@ -456,6 +485,10 @@ void VI_GX_showStats()
 	CntTriNear = 0;
 	CntTriPolyOffset = 0;
 
+	u32 romHits, romMisses, romEvictions;
+	ROMCache_get_stats(&romHits, &romMisses, &romEvictions);
+	sprintf(txtbuffer,"ROMCache: %d hits; %d misses; %d evictions",romHits,romMisses,romEvictions);
+	DEBUG_print(txtbuffer,DBG_ROMCACHEINFO);
 #endif
 }
 
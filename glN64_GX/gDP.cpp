@@ -679,6 +679,7 @@ void gDPLoadTile( u32 tile, u32 uls, u32 ult, u32 lrs, u32 lrt )
 	gDP.textureMode = TEXTUREMODE_NORMAL;
 	gDP.loadType = LOADTYPE_TILE;
 	gDP.changed |= CHANGED_TMEM;
+	gDP.tmemLoads++;
 
 #ifdef DEBUG
 		DebugMsg( DEBUG_HIGH | DEBUG_HANDLED | DEBUG_TEXTURE, "gDPLoadTile( %i, %i, %i, %i, %i );\n",
@@ -763,6 +764,7 @@ void gDPLoadBlock( u32 tile, u32 uls, u32 ult, u32 lrs, u32 dxt )
 	gDP.textureMode = TEXTUREMODE_NORMAL;
 	gDP.loadType = LOADTYPE_BLOCK;
 	gDP.changed |= CHANGED_TMEM;
+	gDP.tmemLoads++;
 
 #ifdef DEBUG
 	DebugMsg( DEBUG_HIGH | DEBUG_HANDLED | DEBUG_TEXTURE, "gDPLoadBlock( %i, %i, %i, %i, %i );\n",
@@ -809,6 +811,7 @@ void gDPLoadTLUT( u32 tile, u32 uls, u32 ult, u32 lrs, u32 lrt )
 	gDP.paletteCRC256 = CRC_Calculate( 0xFFFFFFFF, gDP.paletteCRC16, 64 );
 
 	gDP.changed |= CHANGED_TMEM;
+	gDP.tmemLoads++;
 
 #ifdef DEBUG
 	DebugMsg( DEBUG_HIGH | DEBUG_HANDLED | DEBUG_TEXTURE, "gDPLoadTLUT( %i, %i, %i, %i, %i );\n",
@@ -338,6 +338,7 @@ struct gDPInfo
 	u32 half_1, half_2;
 	u32 textureMode;
 	u32 loadType;
+	u32 tmemLoads; // Counts every load into TMEM, never reset
 };
 
 extern gDPInfo gDP;
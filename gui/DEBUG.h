@@ -28,6 +28,9 @@
 #define DBG_PROFILE_INTERP 25
 #define DBG_PROFILE_TRAMP 26
 #define DBG_PROFILE_FUNCS 27
+#define DBG_PROFILE_SMC 28
+#define DBG_ROMCACHEINFO 29
+#define DBG_TEXCACHEINFO 30
 #define DBG_STATSBASE 12 // ALL stats print from this line onwards
 #define DBG_SDGECKOOPEN 0xFC
 #define DBG_SDGECKOCLOSE 0xFD
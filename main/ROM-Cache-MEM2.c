@@ -33,7 +33,11 @@
 #include "../gui/DEBUG.h"
 #include "../gui/GUI.h"
 #include "ROM-Cache.h"
+#include "wii64config.h"
 #include "gczip.h"
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/semaphore.h>
 #include "zlib.h"
 
 #ifdef MENU_V2
@@ -47,10 +51,15 @@ void LoadingBar_showBar(float percent, const char* string);
 #define DRAWGUI GUI_draw
 #endif
 
-#define BLOCK_SIZE  (512*1024)
+// The block size can be tuned with -DROMCACHE_BLOCK_SHIFT=n
+//   (the cache capacity is ROMCACHE_SIZE in MEM2.h)
+#ifndef ROMCACHE_BLOCK_SHIFT
+#define ROMCACHE_BLOCK_SHIFT 19
+#endif
+#define BLOCK_SHIFT (ROMCACHE_BLOCK_SHIFT)
+#define BLOCK_SIZE  (1<<BLOCK_SHIFT)
 #define BLOCK_MASK  (BLOCK_SIZE-1)
 #define OFFSET_MASK (0xFFFFFFFF-BLOCK_MASK)
-#define BLOCK_SHIFT (19)	//only change ME and BLOCK_SIZE
 #define MAX_ROMSIZE (64*1024*1024)
 #define NUM_BLOCKS  (MAX_ROMSIZE/BLOCK_SIZE)
 #define LOAD_SIZE   (32*1024)
@@ -60,7 +69,26 @@ static int   ROMTooBig;
 //static int   ROMCompressed;
 //static int   ROMHeaderSize;
 static char* ROMBlocks[NUM_BLOCKS];
-static int   ROMBlocksLRU[NUM_BLOCKS];
+// Resident blocks form a doubly linked list from MRU (head) to LRU (tail)
+static int   ROMBlocksPrev[NUM_BLOCKS];
+static int   ROMBlocksNext[NUM_BLOCKS];
+static int   ROMBlocksHead = -1, ROMBlocksTail = -1;
+static u32   ROMCacheHits, ROMCacheMisses, ROMCacheEvictions;
+// Blocks after a sequential run of reads are loaded ahead on a worker thread
+//   ROMCacheLock guards the block table and the LRU list,
+//   ROMFileLock serializes seeking and reading ROMFile
+#define READAHEAD_MAX      ((ROMCACHE_SIZE/BLOCK_SIZE)/4)
+#define PREFETCH_PRIORITY  50 // Below the emulation thread: only uses idle time
+char romReadAhead = ROMREADAHEAD_DEFAULT;
+static lwp_t   prefetchThread = LWP_THREAD_NULL;
+static mutex_t ROMCacheLock, ROMFileLock;
+static sem_t   prefetchWake, prefetchDone;
+static u32     prefetchNext, prefetchEnd;
+static int     prefetchBlock = -1, prefetchWaiting;
+static u32     lastReadBlock = -1;
+// The block last handed to the main thread: it's copied out of (or pointed
+//   into) without ROMCacheLock held, so the prefetch thread mustn't recycle it
+static int     busyBlock = -1;
 static fileBrowser_file* ROMFile;
 static char readBefore = 0;
 
@@ -74,10 +102,48 @@ void DUMMY_setLoadProg(float percent) { }
 void DUMMY_draw() { }
 
 static void ensure_block(u32 block);
+static void* prefetch_thread(void* arg);
+static void wait_prefetch(void);
+
+static void lru_unlink(int block){
+	if(ROMBlocksPrev[block] >= 0) ROMBlocksNext[ROMBlocksPrev[block]] = ROMBlocksNext[block];
+	else ROMBlocksHead = ROMBlocksNext[block];
+	if(ROMBlocksNext[block] >= 0) ROMBlocksPrev[ROMBlocksNext[block]] = ROMBlocksPrev[block];
+	else ROMBlocksTail = ROMBlocksPrev[block];
+}
+
+static void lru_push_front(int block){
+	ROMBlocksPrev[block] = -1;
+	ROMBlocksNext[block] = ROMBlocksHead;
+	if(ROMBlocksHead >= 0) ROMBlocksPrev[ROMBlocksHead] = block;
+	else ROMBlocksTail = block;
+	ROMBlocksHead = block;
+}
+
+void ROMCache_get_stats(u32* hits, u32* misses, u32* evictions){
+	*hits = ROMCacheHits;
+	*misses = ROMCacheMisses;
+	*evictions = ROMCacheEvictions;
+}
 
 PKZIPHEADER pkzip;
 
 void ROMCache_init(fileBrowser_file* f){
+	if(prefetchThread == LWP_THREAD_NULL){
+		LWP_MutexInit(&ROMCacheLock, false);
+		LWP_MutexInit(&ROMFileLock, false);
+		LWP_SemInit(&prefetchWake, 0, 1);
+		LWP_SemInit(&prefetchDone, 0, 1);
+		LWP_CreateThread(&prefetchThread, prefetch_thread, NULL, NULL, 0, PREFETCH_PRIORITY);
+	} else {
+		// Cancel any read ahead for the previous ROM
+		LWP_MutexLock(ROMCacheLock);
+		prefetchNext = prefetchEnd = 0;
+		wait_prefetch();
+		LWP_MutexUnlock(ROMCacheLock);
+	}
+	lastReadBlock = -1;
+	busyBlock = -1;
   readBefore = 0; //de-init byteswapping
   ROMFile = f;
 	ROMSize = f->size;
@@ -103,39 +169,112 @@ void* ROMCache_pointer(u32 rom_offset){
 	}
 }
 
-static void ROMCache_load_block(char* dst, u32 rom_offset){
-  if((hasLoadedROM) && (!stop))
-    pauseAudio();
-	showLoadProgress( 1.0f );
-	u32 offset = 0, bytes_read, loads_til_update = 0;
+// Reads one block from the file, safe to call from the prefetch thread
+static void ROMCache_read_block(char* dst, u32 rom_offset){
+	u32 offset = 0;
+	int bytes_read;
+	LWP_MutexLock(ROMFileLock);
 	romFile_seekFile(ROMFile, rom_offset, FILE_BROWSER_SEEK_SET);
 	while(offset < BLOCK_SIZE){
 		bytes_read = romFile_readFile(ROMFile, dst + offset, LOAD_SIZE);
+		if(bytes_read <= 0) break;
 		byte_swap(dst + offset, bytes_read);
 		offset += bytes_read;
-		
-		if(!loads_til_update--){
-//			showLoadProgress( (float)offset/BLOCK_SIZE );
-			loads_til_update = 32;
-		}
 	}
-//	showLoadProgress( 1.0f );
+	LWP_MutexUnlock(ROMFileLock);
+}
+
+static void ROMCache_load_block(char* dst, u32 rom_offset){
+  if((hasLoadedROM) && (!stop))
+    pauseAudio();
+	showLoadProgress( 1.0f );
+	ROMCache_read_block(dst, rom_offset);
 	if((hasLoadedROM) && (!stop))
 	  resumeAudio();
 }
 
+// Waits for the prefetch thread to publish the block it is loading
+//   Must be called with ROMCacheLock held, which is released while waiting
+static void wait_prefetch(void){
+	while(prefetchBlock >= 0){
+		prefetchWaiting = 1;
+		LWP_MutexUnlock(ROMCacheLock);
+		LWP_SemWait(prefetchDone);
+		LWP_MutexLock(ROMCacheLock);
+	}
+}
+
+static void* prefetch_thread(void* arg){
+	while(1){
+		LWP_SemWait(prefetchWake);
+		LWP_MutexLock(ROMCacheLock);
+		while(prefetchNext < prefetchEnd){
+			u32 block = prefetchNext++;
+			if(ROMBlocks[block]) continue;
+			// Recycle the LRU block, unless the main thread is still using it
+			int lru = ROMBlocksTail;
+			if(lru == busyBlock) lru = ROMBlocksPrev[lru];
+			char* dst = ROMBlocks[lru];
+			++ROMCacheEvictions;
+			lru_unlink(lru);
+			ROMBlocks[lru] = 0;
+			prefetchBlock = block;
+			LWP_MutexUnlock(ROMCacheLock);
+
+			ROMCache_read_block(dst, block << BLOCK_SHIFT);
+
+			LWP_MutexLock(ROMCacheLock);
+			ROMBlocks[block] = dst;
+			lru_push_front(block);
+			prefetchBlock = -1;
+			if(prefetchWaiting){
+				prefetchWaiting = 0;
+				LWP_SemPost(prefetchDone);
+			}
+		}
+		LWP_MutexUnlock(ROMCacheLock);
+	}
+	return NULL;
+}
+
+// Queues the blocks following a sequential read for the prefetch thread
+static void prefetch_from(u32 block){
+	int depth = MIN(romReadAhead, READAHEAD_MAX);
+	u32 end = MIN(block + depth, (ROMSize + BLOCK_MASK) >> BLOCK_SHIFT);
+	if(depth <= 0 || end == prefetchEnd) return;
+
+	LWP_MutexLock(ROMCacheLock);
+	prefetchNext = block;
+	prefetchEnd = end;
+	LWP_MutexUnlock(ROMCacheLock);
+	LWP_SemPost(prefetchWake);
+}
+
 static void ensure_block(u32 block){
+	LWP_MutexLock(ROMCacheLock);
+	if(prefetchBlock == (int)block)
+		wait_prefetch();
 	if(!ROMBlocks[block]){
 		// The block we're trying to read isn't in the cache
-		// Find the Least Recently Used Block
-		int i, max_i = 0, max_lru = 0;
-		for(i=0; i<NUM_BLOCKS; ++i)
-			if(ROMBlocks[i] && ROMBlocksLRU[i] > max_lru)
-				max_i = i, max_lru = ROMBlocksLRU[i];
-		ROMBlocks[block] = ROMBlocks[max_i]; // Take its place
+		// Take the place of the Least Recently Used Block
+		int lru = ROMBlocksTail;
+		++ROMCacheMisses;
+		++ROMCacheEvictions;
+		lru_unlink(lru);
+		ROMBlocks[block] = ROMBlocks[lru]; // Take its place
+		ROMBlocks[lru] = 0; // Evict the LRU block
 		ROMCache_load_block(ROMBlocks[block], block << BLOCK_SHIFT);
-		ROMBlocks[max_i] = 0; // Evict the LRU block
+		lru_push_front(block);
+	} else {
+		++ROMCacheHits;
+		// Move it to the front of the list as the most recently used
+		if(ROMBlocksHead != (int)block){
+			lru_unlink(block);
+			lru_push_front(block);
+		}
 	}
+	busyBlock = block;
+	LWP_MutexUnlock(ROMCacheLock);
 }
 
 void ROMCache_read(u8* dest, u32 offset, u32 length){
@@ -143,6 +282,12 @@ void ROMCache_read(u8* dest, u32 offset, u32 length){
 		u32 block = offset>>BLOCK_SHIFT;
 		u32 length2 = length;
 		u32 offset2 = offset&BLOCK_MASK;
+		u32 last_block = (offset+length-1)>>BLOCK_SHIFT;
+
+		// Reading on into the next block looks like streaming
+		if(block == lastReadBlock+1 || last_block != block)
+			prefetch_from(last_block+1);
+		lastReadBlock = last_block;
 		
 		while(length2){
 			ensure_block(block);
@@ -152,11 +297,6 @@ void ROMCache_read(u8* dest, u32 offset, u32 length){
 				length = BLOCK_SIZE - offset2;
 			else length = length2;
 		
-			// Increment LRU's; set this one to 0
-			int i;
-			for(i=0; i<NUM_BLOCKS; ++i) ++ROMBlocksLRU[i];
-			ROMBlocksLRU[block] = 0;
-			
 			// Actually read for this block
 			memcpy(dest, ROMBlocks[block] + offset2, length);
 			
@@ -218,10 +358,13 @@ int ROMCache_load(fileBrowser_file* f){
 		int i;
 		for(i=0; i<ROMCACHE_SIZE/BLOCK_SIZE; ++i)
 			ROMBlocks[i] = ROMCACHE_LO + i*BLOCK_SIZE;
-		for(; i<ROMSize/BLOCK_SIZE; ++i)
+		for(; i<NUM_BLOCKS; ++i)
 			ROMBlocks[i] = 0;
-		for(i=0; i<ROMSize/BLOCK_SIZE; ++i)
-			ROMBlocksLRU[i] = i;
+		// Lower blocks start out as the most recently used
+		ROMBlocksHead = ROMBlocksTail = -1;
+		for(i=ROMCACHE_SIZE/BLOCK_SIZE-1; i>=0; --i)
+			lru_push_front(i);
+		ROMCacheHits = ROMCacheMisses = ROMCacheEvictions = 0;
 	}
 	
 	SETLOADPROG( -1.0f );
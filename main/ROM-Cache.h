@@ -37,6 +37,8 @@ void ROMCache_read(u8* ram_dest, u32 rom_offset, u32 length);
 int ROMCache_load(fileBrowser_file* file);
 // WARNING: Not necessarily valid after another ROMCache call
 void* ROMCache_pointer(u32 rom_offset);
+// Block cache statistics since the ROM was loaded
+void ROMCache_get_stats(u32* hits, u32* misses, u32* evictions);
 
 /* Byteswapping stuff */
 extern int ROM_byte_swap;
@@ -0,0 +1,134 @@
+/**
+ * Wii64 - lz4.c
+ *
+ * LZ4 block (no frame) compression
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#include <string.h>
+#include "lz4.h"
+
+static unsigned int read32(const unsigned char* p){
+	unsigned int v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static unsigned char* put_length(unsigned char* op, unsigned int len){
+	for(; len >= 255; len -= 255) *op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+/* Follows the format's end of block rules: the last 5 bytes are
+     literals and no match starts in the last 12. */
+int lz4_compress(const unsigned char* src, int len,
+                 unsigned char* dst, int dst_cap, int* table){
+	const unsigned char* anchor = src;
+	const unsigned char* ip = src;
+	const unsigned char* mflimit = src + len - 12;
+	const unsigned char* matchlimit = src + len - 5;
+	unsigned char* op = dst;
+	unsigned char* oend = dst + dst_cap;
+	int i, bits = LZ4_HASH_BITS;
+
+	// Small inputs don't need (or want to clear) the whole table
+	while(bits > 8 && (1 << (bits + 2)) > len) --bits;
+	for(i=0; i<(1 << bits); ++i) table[i] = -1;
+
+	while(ip < mflimit){
+		unsigned int seq = read32(ip);
+		unsigned int h = (seq * 2654435761U) >> (32 - bits);
+		int ref = table[h];
+		table[h] = ip - src;
+		if(ref < 0 || ip - (src + ref) > 65535 || read32(src + ref) != seq){
+			++ip;
+			continue;
+		}
+
+		const unsigned char* match = src + ref;
+		unsigned int mlen = 4;
+		while(ip + mlen < matchlimit && match[mlen] == ip[mlen]) ++mlen;
+
+		unsigned int lit = ip - anchor;
+		// token + lengths + literals + offset
+		if(op + 1 + lit/255 + 1 + lit + 2 + mlen/255 + 1 > oend) return -1;
+		unsigned char* token = op++;
+		*token = (lit >= 15 ? 15 : lit) << 4;
+		if(lit >= 15) op = put_length(op, lit - 15);
+		memcpy(op, anchor, lit); op += lit;
+		*op++ = (ip - match) & 0xFF;
+		*op++ = (ip - match) >> 8;
+		*token |= (mlen - 4 >= 15 ? 15 : mlen - 4);
+		if(mlen - 4 >= 15) op = put_length(op, mlen - 4 - 15);
+
+		ip += mlen;
+		anchor = ip;
+	}
+
+	// The rest goes out as literals
+	unsigned int lit = src + len - anchor;
+	if(op + 1 + lit/255 + 1 + lit > oend) return -1;
+	*op++ = (lit >= 15 ? 15 : lit) << 4;
+	if(lit >= 15) op = put_length(op, lit - 15);
+	memcpy(op, anchor, lit); op += lit;
+
+	return op - dst;
+}
+
+int lz4_decompress(const unsigned char* src, int src_len,
+                   unsigned char* dst, int dst_len){
+	const unsigned char *ip = src, *iend = src + src_len;
+	unsigned char *op = dst, *oend = dst + dst_len;
+	unsigned int token, len, offset, b;
+
+	while(ip < iend){
+		token = *ip++;
+		// Literals
+		len = token >> 4;
+		if(len == 15){
+			do {
+				if(ip >= iend) return -1;
+				b = *ip++; len += b;
+			} while(b == 255);
+		}
+		if(len > iend - ip || len > oend - op) return -1;
+		memcpy(op, ip, len);
+		op += len; ip += len;
+		// The last sequence is only literals
+		if(ip >= iend) break;
+
+		// Match
+		if(iend - ip < 2) return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(!offset || offset > op - dst) return -1;
+		len = token & 15;
+		if(len == 15){
+			do {
+				if(ip >= iend) return -1;
+				b = *ip++; len += b;
+			} while(b == 255);
+		}
+		len += 4;
+		if(len > oend - op) return -1;
+		// The source may overlap what we're writing, copy forward bytewise
+		unsigned char* match = op - offset;
+		while(len--) *op++ = *match++;
+	}
+	return op - dst;
+}
+
@@ -0,0 +1,40 @@
+/**
+ * Wii64 - lz4.h
+ *
+ * LZ4 block (no frame) compression, used where decompression speed
+ *   matters more than size: ROMZ images and savestates
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#define LZ4_HASH_BITS 14
+#define LZ4_HASH_SIZE (1 << LZ4_HASH_BITS)
+// Largest output lz4_compress can produce for len bytes of input
+#define LZ4_BOUND(len) ((len) + (len)/255 + 16)
+
+/* Greedy compressor, returns the compressed size or -1 if it wouldn't
+     fit in dst_cap. table is LZ4_HASH_SIZE ints of scratch space, so
+     several threads can compress at once with their own tables. */
+int lz4_compress(const unsigned char* src, int len,
+                 unsigned char* dst, int dst_cap, int* table);
+/* Returns the decoded size or -1 if src is corrupt or won't fit in dst */
+int lz4_decompress(const unsigned char* src, int src_len,
+                   unsigned char* dst, int dst_len);
+
+#endif
+
@@ -39,6 +39,7 @@
 #include "rom.h"
 #include "plugin.h"
 #include "savestates.h"
+#include "runahead.h"
 #include <gccore.h>
 #include "../gui/gui_GX-menu.h"
 #include "../gui/GUI.h"
@@ -60,6 +61,7 @@ unsigned int MALLOC_MEM2 = 0;
 #include "../gc_memory/tlb.h"
 #include "../gc_memory/pif.h"
 #include "ROM-Cache.h"
+#include "../fileBrowser/fileBrowser-ROMZ.h"
 #include "wii64config.h"
 
 /* NECESSARY FUNCTIONS AND VARIABLES */
@@ -247,6 +249,7 @@ int loadROM(fileBrowser_file* rom){
 		closeDLL_gfx();
 
 		ROMCache_deinit();
+		fileBrowser_ROMZ_close();
 		free_memory();
 #ifndef HW_RVL
 		ARAM_manager_deinit();
@@ -374,7 +377,7 @@ static void rsp_info_init(void){
 	rsp_info.DPC_PIPEBUSY_REG = &dpc_register.dpc_pipebusy;
 	rsp_info.DPC_TMEM_REG = &dpc_register.dpc_tmem;
 	rsp_info.CheckInterrupts = dummy_func;
-	rsp_info.ProcessDlistList = processDList;
+	rsp_info.ProcessDlistList = runahead_processDList;
 	rsp_info.ProcessAlistList = processAList;
 	rsp_info.ProcessRdpList = processRDPList;
 	rsp_info.ShowCFB = showCFB;
@@ -59,9 +59,11 @@ extern "C" {
 #include "../gc_memory/flashram.h"
 #include "../gc_memory/Saves.h"
 #include "../main/savestates.h"
+#include "../main/runahead.h"
 #include "ROM-Cache.h"
 #include "../fileBrowser/fileBrowser.h"
 #include "../fileBrowser/fileBrowser-libfat.h"
+#include "../fileBrowser/fileBrowser-ROMZ.h"
 #include "../fileBrowser/fileBrowser-CARD.h"
 #include "wii64config.h"
 }
@@ -155,6 +157,15 @@ static struct {
   { "Pak3", &pakMode[2], PAKMODE_MEMPAK, PAKMODE_RUMBLEPAK },
   { "Pak4", &pakMode[3], PAKMODE_MEMPAK, PAKMODE_RUMBLEPAK },
   { "LoadButtonSlot", &loadButtonSlot, LOADBUTTON_SLOT0, LOADBUTTON_DEFAULT },
+  { "ReadAhead", &romReadAhead, ROMREADAHEAD_DISABLE, ROMREADAHEAD_MAX },
+  { "StatesCodec", &saveStateCodec, SAVESTATECODEC_ZLIB, SAVESTATECODEC_LZ4 },
+  { "Rewind", &rewindEnabled, REWIND_DISABLE, REWIND_ENABLE },
+  { "RewindInterval", &rewindInterval, REWINDINTERVAL_MIN, REWINDINTERVAL_MAX },
+  { "RewindDepth", &rewindDepth, REWINDDEPTH_MIN, REWINDDEPTH_MAX },
+  { "RewindBudget", &rewindBudget, REWINDBUDGET_MIN, REWINDBUDGET_MAX },
+  { "RunAhead", &runAheadFrames, RUNAHEAD_DISABLE, RUNAHEAD_MAX },
+  { "AudioTaskDelay", &audioTaskDelay, AUDIOTASKDELAY_SYNC, AUDIOTASKDELAY_MAX },
+  { "AudioLatency", &audioLatency, AUDIOLATENCY_FIXED, AUDIOLATENCY_MAX },
 };
 void handleConfigPair(char* kv);
 void readConfig(FILE* f);
@@ -366,6 +377,7 @@ int loadROM(fileBrowser_file* rom){
 	// First, if there's already a loaded ROM
 	if(hasLoadedROM){
 		// Unload it, and deinit everything
+		saveJournal_close();
 		cpu_deinit();
 		eepromWritten = FALSE;
 		mempakWritten = FALSE;
@@ -381,6 +393,7 @@ int loadROM(fileBrowser_file* rom){
 		closeDLL_gfx();
 
 		ROMCache_deinit();
+		fileBrowser_ROMZ_close();
 		free_memory();
 #ifndef HW_RVL
 		ARAM_manager_deinit();
@@ -455,6 +468,7 @@ int loadROM(fileBrowser_file* rom){
   	result += loadSram(saveFile_dir);
   	result += loadMempak(saveFile_dir);
   	result += loadFlashram(saveFile_dir);
+  	result += saveJournal_open(saveFile_dir);
   	saveFile_deinit(saveFile_dir);
 
   	switch (nativeSaveDevice)
@@ -569,7 +583,7 @@ static void rsp_info_init(void){
 	rsp_info.DPC_PIPEBUSY_REG = &dpc_register.dpc_pipebusy;
 	rsp_info.DPC_TMEM_REG = &dpc_register.dpc_tmem;
 	rsp_info.CheckInterrupts = dummy_func;
-	rsp_info.ProcessDlistList = processDList;
+	rsp_info.ProcessDlistList = runahead_processDList;
 	rsp_info.ProcessAlistList = processAList;
 	rsp_info.ProcessRdpList = processRDPList;
 	rsp_info.ShowCFB = showCFB;
@@ -273,6 +273,8 @@ extern void closeDLL_RSP();
 extern DWORD doRspCycles(DWORD Cycles);
 extern void initiateRSP(RSP_INFO Rsp_Info, DWORD * CycleCount);
 extern void romClosed_RSP();
+// Finishes an audio task left running in the background
+extern void joinAudioTask_RSP(void);
 
 // frame buffer plugin spec extension
 
@@ -0,0 +1,384 @@
+/**
+ * Wii64 - rewind.c
+ *
+ * Ring of in-memory snapshots for rewinding gameplay
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ogc/lwp.h>
+#include <ogc/semaphore.h>
+#include <ogc/lwp_watchdog.h>
+#include "rewind.h"
+#include "savestates.h"
+#include "lz4.h"
+#include "wii64config.h"
+#include "../gc_memory/memory.h"
+#include "../r4300/Invalid_Code.h"
+
+/* Each snapshot holds the registers and the pages of RDRAM and SP memory
+ * which changed since the snapshot before it, each compressed on its own.
+ * RDRAM pages have changed when their write generation (rdram_page_gen)
+ * has moved on; SP memory has no generations, so its 8KB are compared
+ * against a copy.  The oldest snapshot always holds every page, when it's
+ * dropped the pages the next one lacks are handed on to it.  Restoring
+ * snapshot k only rewrites the pages which changed after k, taking each
+ * from the newest snapshot at or before k which has it.
+ */
+
+#define PAGE_SIZE       REWIND_PAGE_SIZE
+#define STAGE_PAGES     64   // usual size of the worker's staging area
+#define REWIND_VIS      60   // how far back a rewind goes
+#define REWIND_PRIORITY 50
+
+typedef struct {
+	unsigned short page, len; // len is PAGE_SIZE if the page is stored as is
+	unsigned char* data;
+} rewind_page;
+
+typedef struct {
+	rewind_page* pages;       // sorted by page
+	int          num_pages;
+	char*        regs;
+	int          regs_len;
+	unsigned int bytes;
+} rewind_snapshot;
+
+char rewindEnabled  = REWIND_DISABLE;
+char rewindInterval = REWINDINTERVAL_DEFAULT;
+char rewindDepth    = REWINDDEPTH_DEFAULT;
+char rewindBudget   = REWINDBUDGET_DEFAULT;
+
+static rewind_snapshot ring[REWINDDEPTH_MAX];
+static int ringHead, ringCount;   // ringHead is the oldest snapshot
+static unsigned int ringBytes;
+#define SNAPSHOT(i) (&ring[(ringHead + (i)) % REWINDDEPTH_MAX])
+
+// Every page as of the newest snapshot
+static unsigned int pageGen[RDRAM_PAGES];
+static unsigned char spCopy[(REWIND_PAGES - RDRAM_PAGES) * PAGE_SIZE];
+static int genValid, viCount;
+static unsigned int lastSaveTime, lastRestoreTime;
+
+// Pages are copied here for the worker to compress while emulation goes on
+static unsigned char* stage;
+static int stagePages;
+static rewind_snapshot* jobSnapshot;
+static int jobCount, jobFailed, jobPending;
+static lwp_t rewindThread = LWP_THREAD_NULL;
+static sem_t jobReady, jobDone;
+// Only one of the worker and the main thread compresses at a time
+static int lz4Table[LZ4_HASH_SIZE];
+static unsigned char compBuf[LZ4_BOUND(PAGE_SIZE)];
+
+unsigned char* rewind_page_ptr(int page){
+	if(page < RDRAM_PAGES) return (unsigned char*)rdram + page*PAGE_SIZE;
+	return (unsigned char*)SP_DMEM + (page - RDRAM_PAGES)*PAGE_SIZE;
+}
+
+// Whether page still holds what it did in the newest snapshot
+static int page_unchanged(int page){
+	if(page < RDRAM_PAGES) return rdram_page_gen[page] == pageGen[page];
+	return !memcmp(spCopy + (page - RDRAM_PAGES)*PAGE_SIZE, rewind_page_ptr(page), PAGE_SIZE);
+}
+
+static void page_snapshotted(int page){
+	if(page < RDRAM_PAGES) pageGen[page] = rdram_page_gen[page];
+	else memcpy(spCopy + (page - RDRAM_PAGES)*PAGE_SIZE, rewind_page_ptr(page), PAGE_SIZE);
+}
+
+// Returns 0 if the page couldn't be allocated
+static int store_page(rewind_page* rp, const unsigned char* src){
+	int len = lz4_compress(src, PAGE_SIZE, compBuf, PAGE_SIZE - 1, lz4Table);
+	if(len < 0) len = PAGE_SIZE;
+	else src = compBuf;
+
+	rp->len  = len;
+	rp->data = malloc(len);
+	if(!rp->data) return 0;
+	memcpy(rp->data, src, len);
+	return 1;
+}
+
+void rewind_page_written(int page){
+	if(page < RDRAM_PAGES){
+		invalid_code_check_write(page*PAGE_SIZE, PAGE_SIZE);
+		rdram_page_written(page*PAGE_SIZE, PAGE_SIZE);
+	}
+}
+
+static void restore_page(rewind_page* rp){
+	unsigned char* dst = rewind_page_ptr(rp->page);
+	if(rp->len == PAGE_SIZE) memcpy(dst, rp->data, PAGE_SIZE);
+	else lz4_decompress(rp->data, rp->len, dst, PAGE_SIZE);
+	rewind_page_written(rp->page);
+	// The target becomes the newest snapshot
+	page_snapshotted(rp->page);
+}
+
+static unsigned int snapshot_bytes(rewind_snapshot* s){
+	unsigned int bytes = s->num_pages * sizeof(rewind_page) + s->regs_len;
+	int i;
+	for(i=0; i<s->num_pages; ++i) bytes += s->pages[i].len;
+	return bytes;
+}
+
+static void free_snapshot(rewind_snapshot* s){
+	int i;
+	for(i=0; i<s->num_pages; ++i) free(s->pages[i].data);
+	free(s->pages);
+	free(s->regs);
+	memset(s, 0, sizeof(rewind_snapshot));
+}
+
+static void* rewind_thread(void* arg){
+	int i;
+	while(1){
+		LWP_SemWait(jobReady);
+		for(i=0; i<jobCount; ++i)
+			if(!store_page(&jobSnapshot->pages[i], stage + i*PAGE_SIZE))
+				jobFailed = 1;
+		LWP_SemPost(jobDone);
+	}
+	return NULL;
+}
+
+static void rewind_reset(void){
+	while(ringCount){
+		free_snapshot(SNAPSHOT(ringCount-1));
+		--ringCount;
+	}
+	ringHead = ringBytes = 0;
+	genValid = viCount = 0;
+}
+
+static void wait_job(void){
+	if(!jobPending) return;
+	LWP_SemWait(jobDone);
+	jobPending = 0;
+
+	// A full snapshot grew the stage, don't hold on to that
+	if(stagePages > STAGE_PAGES){
+		unsigned char* small = realloc(stage, STAGE_PAGES * PAGE_SIZE);
+		if(small) stage = small;
+		stagePages = STAGE_PAGES;
+	}
+
+	// A snapshot with holes would make every older one wrong too
+	if(jobFailed) rewind_reset();
+	else {
+		jobSnapshot->bytes = snapshot_bytes(jobSnapshot);
+		ringBytes += jobSnapshot->bytes;
+	}
+}
+
+// Drops the oldest snapshot, moving the pages the next one lacks into it
+static void drop_oldest(void){
+	rewind_snapshot* old = SNAPSHOT(0);
+	rewind_snapshot* next = SNAPSHOT(1);
+	rewind_page* merged;
+	int i = 0, j = 0, n = 0;
+
+	if(ringCount == 1){
+		rewind_reset();
+		return;
+	}
+	merged = malloc((old->num_pages + next->num_pages) * sizeof(rewind_page));
+	if(!merged){
+		rewind_reset();
+		return;
+	}
+
+	ringBytes -= old->bytes + next->bytes;
+	while(i < old->num_pages || j < next->num_pages){
+		if(j == next->num_pages ||
+		   (i < old->num_pages && old->pages[i].page < next->pages[j].page)){
+			merged[n++] = old->pages[i++];
+		} else {
+			if(i < old->num_pages && old->pages[i].page == next->pages[j].page)
+				free(old->pages[i++].data);
+			merged[n++] = next->pages[j++];
+		}
+	}
+	free(next->pages);
+	next->pages = realloc(merged, n * sizeof(rewind_page));
+	if(!next->pages) next->pages = merged;
+	next->num_pages = n;
+	next->bytes = snapshot_bytes(next);
+	ringBytes += next->bytes;
+
+	// Its pages now belong to next
+	old->num_pages = 0;
+	free_snapshot(old);
+	ringHead = (ringHead + 1) % REWINDDEPTH_MAX;
+	--ringCount;
+}
+
+void rewind_init(void){
+	wait_job();
+	rewind_reset();
+}
+
+void rewind_deinit(void){
+	rewind_init();
+	free(stage);
+	stage = NULL;
+	stagePages = 0;
+}
+
+void rewind_new_vi(void){
+	if(!rewindEnabled){
+		if(stage) rewind_deinit();
+		return;
+	}
+	if(++viCount >= rewindInterval){
+		viCount = 0;
+		savestates_job |= REWINDSAVE;
+	}
+}
+
+void rewind_save(void){
+	static unsigned short changed[REWIND_PAGES];
+	static char regs[SAVESTATE_REGS_MAX];
+	long long start = gettime();
+	rewind_snapshot* s;
+	int i, num_changed = 0;
+
+	if(!stage){
+		stage = malloc(STAGE_PAGES * PAGE_SIZE);
+		if(!stage) return;
+		stagePages = STAGE_PAGES;
+		if(rewindThread == LWP_THREAD_NULL){
+			LWP_SemInit(&jobReady, 0, 1);
+			LWP_SemInit(&jobDone, 0, 1);
+			LWP_CreateThread(&rewindThread, rewind_thread, NULL, NULL, 0, REWIND_PRIORITY);
+		}
+	}
+	wait_job();
+	while(ringCount && (ringCount >= rewindDepth ||
+	                    ringBytes > ((unsigned int)rewindBudget << 20)))
+		drop_oldest();
+	// The oldest snapshot has to have every page
+	if(!ringCount) genValid = 0;
+
+	for(i=0; i<REWIND_PAGES; ++i){
+		if(genValid && page_unchanged(i)) continue;
+		page_snapshotted(i);
+		changed[num_changed++] = i;
+	}
+	genValid = 1;
+
+	s = SNAPSHOT(ringCount);
+	s->regs_len = savestates_save_regs(regs);
+	s->regs  = malloc(s->regs_len);
+	s->pages = malloc((num_changed ? num_changed : 1) * sizeof(rewind_page));
+	if(!s->regs || !s->pages){
+		free_snapshot(s);
+		rewind_reset();
+		return;
+	}
+	memcpy(s->regs, regs, s->regs_len);
+	s->num_pages = num_changed;
+	++ringCount;
+
+	// Full snapshots (the first one, or after a reset) need a bigger stage:
+	//   copying every page is far quicker than compressing them here
+	if(num_changed > stagePages){
+		unsigned char* big = realloc(stage, num_changed * PAGE_SIZE);
+		if(big){
+			stage = big;
+			stagePages = num_changed;
+		}
+	}
+
+	// Only without memory for that is anything compressed right away
+	jobFailed = 0;
+	for(i=0; i<num_changed; ++i){
+		s->pages[i].page = changed[i];
+		s->pages[i].data = NULL;
+		s->pages[i].len  = 0;
+		if(i < stagePages)
+			memcpy(stage + i*PAGE_SIZE, rewind_page_ptr(changed[i]), PAGE_SIZE);
+		else if(!store_page(&s->pages[i], rewind_page_ptr(changed[i])))
+			jobFailed = 1;
+	}
+
+	jobSnapshot = s;
+	jobCount = num_changed < stagePages ? num_changed : stagePages;
+	jobPending = 1;
+	LWP_SemPost(jobReady);
+
+	lastSaveTime = ticks_to_microsecs(gettime() - start);
+}
+
+int rewind_request(void){
+	if(!ringCount) return 0;
+	savestates_job |= REWINDSTATE;
+	return 1;
+}
+
+void rewind_restore(void){
+	static unsigned char need[REWIND_PAGES];
+	long long start = gettime();
+	rewind_snapshot* s;
+	int i, j, target, remaining = 0;
+
+	wait_job();
+	if(!ringCount) return;
+	target = ringCount - (REWIND_VIS + rewindInterval - 1) / rewindInterval;
+	if(target < 0) target = 0;
+
+	// Pages written since the newest snapshot or by the ones after target
+	for(i=0; i<REWIND_PAGES; ++i)
+		need[i] = !page_unchanged(i);
+	for(j=target+1; j<ringCount; ++j){
+		s = SNAPSHOT(j);
+		for(i=0; i<s->num_pages; ++i) need[s->pages[i].page] = 1;
+	}
+	for(i=0; i<REWIND_PAGES; ++i) remaining += need[i];
+
+	for(j=target; j>=0 && remaining; --j){
+		s = SNAPSHOT(j);
+		for(i=0; i<s->num_pages; ++i){
+			if(!need[s->pages[i].page]) continue;
+			restore_page(&s->pages[i]);
+			need[s->pages[i].page] = 0;
+			--remaining;
+		}
+	}
+	savestates_load_regs(SNAPSHOT(target)->regs);
+
+	// Anything after the target is the future now
+	while(ringCount > target + 1){
+		s = SNAPSHOT(ringCount-1);
+		ringBytes -= s->bytes;
+		free_snapshot(s);
+		--ringCount;
+	}
+	viCount = 0;
+
+	lastRestoreTime = ticks_to_microsecs(gettime() - start);
+}
+
+void rewind_get_stats(int* snapshots, unsigned int* bytes,
+                      unsigned int* save_us, unsigned int* restore_us){
+	*snapshots  = ringCount;
+	*bytes      = ringBytes;
+	*save_us    = lastSaveTime;
+	*restore_us = lastRestoreTime;
+}
+
@@ -0,0 +1,58 @@
+/**
+ * Wii64 - rewind.h
+ *
+ * Ring of in-memory snapshots for rewinding gameplay
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#ifndef REWIND_H
+#define REWIND_H
+
+// RDRAM followed by SP DMEM and IMEM, in the pages snapshots are made of
+#ifdef USE_EXPANSION
+#define RDRAM_PAGES 0x800
+#else
+#define RDRAM_PAGES 0x400
+#endif
+#define REWIND_PAGES     (RDRAM_PAGES + 2)
+#define REWIND_PAGE_SIZE 0x1000
+
+// Forgets every snapshot, called whenever the CPU is reset
+void rewind_init(void);
+void rewind_deinit(void);
+
+// Called every VI, schedules a snapshot (REWINDSAVE) every rewindInterval
+void rewind_new_vi(void);
+// Takes a snapshot, run from gen_interupt like savestates_save
+void rewind_save(void);
+
+// Schedules a rewind of about a second (REWINDSTATE)
+//   returns 0 if there's nothing to rewind to
+int  rewind_request(void);
+// Goes back to the scheduled snapshot, run from gen_interupt
+void rewind_restore(void);
+
+// Snapshots held, the memory they use and what the last save/restore cost
+void rewind_get_stats(int* snapshots, unsigned int* bytes,
+                      unsigned int* save_us, unsigned int* restore_us);
+
+// Also used by run-ahead, which snapshots the same memory
+unsigned char* rewind_page_ptr(int page);
+// Invalidates any code on a page which was just overwritten
+void           rewind_page_written(int page);
+
+#endif
+
@@ -37,6 +37,7 @@
 #include "ROM-Cache.h"
 #include "../gc_memory/memory.h"
 #include "../fileBrowser/fileBrowser.h"
+#include "../fileBrowser/fileBrowser-ROMZ.h"
 
 #define PRINT GUI_print
 
@@ -126,33 +127,48 @@ bool isEEPROM16k()
   return false;
 }
 
+// Both swaps are done a word at a time in a single pass over the buffer.
+//   The masks work on whatever the host byte order is, and the shifts
+//   compile down to rotate-and-insert on PPC.
+#define SWAP_HALVES(w) ((((w) & 0x00FF00FF) << 8) | (((w) >> 8) & 0x00FF00FF))
+#define SWAP_WORD(w)   (((w) << 24) | (((w) & 0xFF00) << 8) | \
+                        (((w) >> 8) & 0xFF00) | ((w) >> 24))
+
 void byte_swap(char* buffer, unsigned int length){
 	if(ROM_byte_swap == BYTE_SWAP_NONE || ROM_byte_swap == BYTE_SWAP_BAD)
 		return;
 
-	int i = 0;
-	u8 aByte = 0;
-	u16 aShort = 0;
-	u16 *buffer_short = (unsigned short*)buffer;
+	u32* words = (u32*)buffer;
+	unsigned int i, count = length >> 2;
+	u32 w0, w1, w2, w3;
 
 	if(ROM_byte_swap == BYTE_SWAP_HALF){	//aka little endian (40123780) vs (80371240)
-		for(i=0; i<length; i+=2) 	//get it from (40123780) to (12408037)
-		{
-			aByte 		= buffer[i];
-			buffer[i] 	= buffer[i+1];
-			buffer[i+1] = aByte;
+		for(i=0; i+4<=count; i+=4){
+			w0 = words[i];   w1 = words[i+1];
+			w2 = words[i+2]; w3 = words[i+3];
+			words[i]   = SWAP_WORD(w0); words[i+1] = SWAP_WORD(w1);
+			words[i+2] = SWAP_WORD(w2); words[i+3] = SWAP_WORD(w3);
 		}
-		for(i=0; i<length/2; i+=2)	//get it from (12408037) to (80371240)
-		{
-			aShort        		= buffer_short[i];
-			buffer_short[i]   	= buffer_short[i+1];
-			buffer_short[i+1] 	= aShort;
+		for(; i<count; ++i){
+			w0 = words[i];
+			words[i] = SWAP_WORD(w0);
 		}
 	} else if(ROM_byte_swap == BYTE_SWAP_BYTE){	// (37804012) vs (80371240)
-		for(i=0; i<length; i+=2){
-			aByte 		= buffer[i];
-			buffer[i] 	= buffer[i+1];
-			buffer[i+1] = aByte;
+		for(i=0; i+4<=count; i+=4){
+			w0 = words[i];   w1 = words[i+1];
+			w2 = words[i+2]; w3 = words[i+3];
+			words[i]   = SWAP_HALVES(w0); words[i+1] = SWAP_HALVES(w1);
+			words[i+2] = SWAP_HALVES(w2); words[i+3] = SWAP_HALVES(w3);
+		}
+		for(; i<count; ++i){
+			w0 = words[i];
+			words[i] = SWAP_HALVES(w0);
+		}
+		// A trailing halfword can still be swapped on its own
+		if(length & 2){
+			u8 aByte = buffer[length-2];
+			buffer[length-2] = buffer[length-1];
+			buffer[length-1] = aByte;
 		}
 	}
 }
@@ -162,13 +178,16 @@ int rom_read(fileBrowser_file* file){
 
    char buffer[1024];
    int i;
-   rom_file = file;
-   rom_length = file->size;
+   // Block compressed images are read through fileBrowser-ROMZ
+   if(fileBrowser_ROMZ_open(file, &rom_file) < 0)
+     return ROM_CACHE_ERROR_READ;
+   rom_length = rom_file->size;
 
    ROMCache_init(rom_file);
    int ret = ROMCache_load(rom_file);
    if(ret) {
      ROMCache_deinit(rom_file);
+     fileBrowser_ROMZ_close();
      return ret;
    }
    if(!ROM_HEADER) ROM_HEADER = malloc(sizeof(rom_header));
@@ -0,0 +1,137 @@
+/**
+ * Wii64 - runahead.c
+ *
+ * Runs frames ahead of the one shown to hide the game's input latency
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ogc/lwp_watchdog.h>
+#include "runahead.h"
+#include "rewind.h"
+#include "savestates.h"
+#include "plugin.h"
+#include "wii64config.h"
+#include "../r4300/Invalid_Code.h"
+
+/* The snapshot is kept as a plain copy of every page.  Each RDRAM page
+ * remembers the write generation (rdram_page_gen) it was copied at, so
+ * taking one copies only the pages the real frame wrote to and restoring
+ * copies back only the pages the frames ahead wrote to.  Per frame that's
+ * a counter compare for each RDRAM page plus the copies, and a memcmp of
+ * the 8KB of SP memory, which has no generations.
+ * Nothing is compressed: this runs twice every frame.
+ */
+
+#define PAGE_SIZE REWIND_PAGE_SIZE
+
+char runAheadFrames = RUNAHEAD_DISABLE;
+int runAheadPhase, runAheadTarget;
+
+static unsigned char* shadow;
+static unsigned int shadowGen[RDRAM_PAGES];
+static int shadowValid, noMemory;
+static char regs[SAVESTATE_REGS_MAX];
+
+static long long aheadStart;
+static unsigned int lastSaveTime, lastRestoreTime, lastFrameTime;
+
+void runahead_init(void){
+	runAheadPhase = runAheadTarget = 0;
+	savestates_job &= ~(RUNAHEADSAVE | RUNAHEADLOAD);
+	// Memory may have been replaced without its generations moving
+	shadowValid = 0;
+	noMemory = 0;
+}
+
+void runahead_deinit(void){
+	runahead_init();
+	free(shadow);
+	shadow = NULL;
+}
+
+void runahead_new_vi(void){
+	if(runAheadPhase){
+		if(runAheadPhase < runAheadTarget) ++runAheadPhase;
+		else savestates_job |= RUNAHEADLOAD;
+		return;
+	}
+
+	// The setting only takes effect between real frames
+	if(!runAheadFrames){
+		if(shadow) runahead_deinit();
+	} else if(!shadow && !noMemory){
+		shadow = malloc(REWIND_PAGES * PAGE_SIZE);
+		shadowValid = 0;
+		noMemory = !shadow;
+	}
+	runAheadTarget = shadow ? runAheadFrames : 0;
+	if(runAheadTarget) savestates_job |= RUNAHEADSAVE;
+}
+
+// Whether page still holds what the shadow does
+static int page_unchanged(int i){
+	if(i < RDRAM_PAGES) return rdram_page_gen[i] == shadowGen[i];
+	return !memcmp(shadow + i*PAGE_SIZE, rewind_page_ptr(i), PAGE_SIZE);
+}
+
+void runahead_save(void){
+	long long start = gettime();
+	int i;
+
+	for(i=0; i<REWIND_PAGES; ++i){
+		if(shadowValid && page_unchanged(i)) continue;
+		memcpy(shadow + i*PAGE_SIZE, rewind_page_ptr(i), PAGE_SIZE);
+		if(i < RDRAM_PAGES) shadowGen[i] = rdram_page_gen[i];
+	}
+	shadowValid = 1;
+	savestates_save_regs(regs);
+
+	runAheadPhase = 1;
+	aheadStart = start;
+	lastSaveTime = ticks_to_microsecs(gettime() - start);
+}
+
+void runahead_restore(void){
+	long long start = gettime();
+	int i;
+
+	for(i=0; i<REWIND_PAGES; ++i){
+		if(page_unchanged(i)) continue;
+		memcpy(rewind_page_ptr(i), shadow + i*PAGE_SIZE, PAGE_SIZE);
+		rewind_page_written(i);
+		// The page matches the shadow again
+		if(i < RDRAM_PAGES) shadowGen[i] = rdram_page_gen[i];
+	}
+	savestates_load_regs(regs);
+
+	runAheadPhase = 0;
+	lastRestoreTime = ticks_to_microsecs(gettime() - start);
+	lastFrameTime   = ticks_to_microsecs(gettime() - aheadStart);
+}
+
+void runahead_processDList(void){
+	if(RUNAHEAD_SHOW_VIDEO) processDList();
+}
+
+void runahead_get_stats(int* frames, unsigned int* save_us,
+                        unsigned int* restore_us, unsigned int* frame_us){
+	*frames     = noMemory ? -1 : runAheadTarget;
+	*save_us    = lastSaveTime;
+	*restore_us = lastRestoreTime;
+	*frame_us   = lastFrameTime;
+}
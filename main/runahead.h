@@ -0,0 +1,56 @@
+/**
+ * Wii64 - runahead.h
+ *
+ * Runs frames ahead of the one shown to hide the game's input latency
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#ifndef RUNAHEAD_H
+#define RUNAHEAD_H
+
+/* With run-ahead set to K, every real frame is followed by K frames
+ * emulated from a snapshot, and the state is put back afterwards:
+ *   phase 0      the real frame: heard, not shown
+ *   phase 1..K   frames ahead: not heard, only the Kth is shown
+ * The frames ahead read the pads as they are now, so the frame shown
+ * already reacts to input the real frame hasn't seen yet.
+ */
+extern int runAheadPhase;
+extern int runAheadTarget; // K for the current frame, 0 when off
+
+#define RUNAHEAD_SHOW_VIDEO (runAheadPhase == runAheadTarget)
+#define RUNAHEAD_PLAY_AUDIO (!runAheadPhase)
+
+// Forgets the snapshot, called on reset and whenever a state is loaded
+void runahead_init(void);
+void runahead_deinit(void);
+
+// Called every VI, schedules the snapshot (RUNAHEADSAVE)
+//   and the restore (RUNAHEADLOAD) for gen_interupt
+void runahead_new_vi(void);
+void runahead_save(void);
+void runahead_restore(void);
+
+// ProcessDList for the RSP, skipping display lists nobody will see
+void runahead_processDList(void);
+
+// Frames run ahead (-1 if there wasn't memory for the snapshot),
+//   what the last snapshot and restore cost and what running ahead
+//   added to the last frame in all
+void runahead_get_stats(int* frames, unsigned int* save_us,
+                        unsigned int* restore_us, unsigned int* frame_us);
+
+#endif
@@ -31,12 +31,23 @@
 
 #define SAVESTATE 1
 #define LOADSTATE 2
+#define REWINDSTATE 4
+#define REWINDSAVE 8
+#define RUNAHEADSAVE 16
+#define RUNAHEADLOAD 32
 
 extern int savestates_job;
 
 void savestates_save();
-void savestates_load();
+// Returns 0 if the state couldn't be loaded
+int  savestates_load();
 int  savestates_exists(int mode);
 
 void savestates_select_slot(unsigned int s);
 void savestates_select_filename();
+
+/* Everything in a savestate except RDRAM, SP memory and the TLB LUTs,
+     for the in-memory snapshots taken by rewind */
+#define SAVESTATE_REGS_MAX 4096
+int  savestates_save_regs(char* buf);
+void savestates_load_regs(char* buf);
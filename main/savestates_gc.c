@@ -30,22 +30,56 @@
 **/ 
 
 #include <zlib.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <gccore.h>
+#include <ogc/lwp.h>
+#include <ogc/semaphore.h>
 #include "savestates.h"
 #include "guifuncs.h"
 #include "rom.h"
+#include "lz4.h"
 #include "../gc_memory/memory.h"
 #include "../gc_memory/flashram.h"
 #include "../r4300/r4300.h"
 #include "../r4300/interupt.h"
 #include "../gc_memory/TLB-Cache.h"
+#include "../r4300/Invalid_Code.h"
 #include "../fileBrowser/fileBrowser-libfat.h"
+#include "../gui/DEBUG.h"
 #include "wii64config.h"
 
+/* Savestates are a chunked container, all of its fields are big endian:
+ *   header   magic "W64S", version, codec, number of chunks, TOC offset
+ *            and the Adler-32 of the TOC
+ *   chunks   the state cut into STATE_CHUNK_SIZE pieces, each compressed on
+ *            its own with the header's codec, or stored as is when that
+ *            wouldn't make it any smaller
+ *   TOC      per chunk: uncompressed size, stored size, file offset and
+ *            the Adler-32 of the stored data
+ * The state itself holds the same fields in the same order as the old gzip
+ * states, except that the TLB is stored as (page, value) pairs ending in
+ * 0xFFFFFFFF.  A worker thread compresses one chunk while the main thread
+ * writes the last one out, so the card I/O overlaps the codec.  Loading
+ * checks every chunk against the TOC before any of the state is applied,
+ * then decodes them on the worker while the main thread applies the last
+ * one.  Old gzip states still load.
+ */
+#define STATE_MAGIC       0x57363453 // "W64S"
+#define STATE_VERSION     3
+#define STATE_HEADER_SIZE 24
+#define STATE_CODEC_ZLIB  1
+#define STATE_CODEC_LZ4   2
+#define STATE_CHUNK_SIZE  (128*1024)
+#define STATE_TOC_ENTRY   16
+// RDRAM plus 16MB, which is several times the TLB pairs 32 entries can map
+#define STATE_MAX_CHUNKS  ((0x800000 + 0x1000000) / STATE_CHUNK_SIZE)
+#define STATE_PRIORITY    50
+
 char* statespath = "/wii64/saves/";
+char saveStateCodec = SAVESTATECODEC_LZ4;
 
 extern unsigned long interp_addr;
 extern int *autoinc_save_slot;
@@ -56,6 +90,445 @@ int savestates_job = 0;
 extern BOOL hasLoadedROM;
 static unsigned int savestates_slot = 0;
 
+static FILE* stateFile;
+static int   stateCodec, stateLoading, stateError;
+// Two chunks are in flight: one with the worker, one being filled/drained
+static unsigned char* stateRaw[2];
+static unsigned char* stateComp[2];
+static unsigned char* stateIn[2];    // loading: where each chunk is decoded from
+static unsigned char* stateStage;    // loading: every chunk, as stored
+static unsigned int   stateRawLen[2], stateCompLen[2];
+static unsigned long  stateSum[2];
+static int            stateOK[2];
+static unsigned int   stateChunks;   // chunks handed to the worker
+static unsigned int   stateWorked;   // chunks the worker has picked up
+static unsigned int   stateWritten;  // saving: chunks written out
+static int            stateCurrent;  // loading: chunk being read from
+static unsigned int   stateNumChunks, stateFill;
+static unsigned char* stateTOC;
+static unsigned int   stateOffset;
+static z_stream stateZ;
+static int      stateHash[LZ4_HASH_SIZE];
+static lwp_t    stateThread = LWP_THREAD_NULL;
+static sem_t    stateJob, stateDone[2];
+
+static void put_be32(unsigned char* p, unsigned int v){
+	p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static unsigned int get_be32(const unsigned char* p){
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void state_encode(int slot){
+	unsigned int len = stateRawLen[slot];
+	int comp_len = -1;
+
+	if(stateCodec == STATE_CODEC_LZ4){
+		comp_len = lz4_compress(stateRaw[slot], len, stateComp[slot], len - 1, stateHash);
+	} else {
+		deflateReset(&stateZ);
+		stateZ.next_in   = stateRaw[slot];
+		stateZ.avail_in  = len;
+		stateZ.next_out  = stateComp[slot];
+		stateZ.avail_out = len - 1;
+		if(deflate(&stateZ, Z_FINISH) == Z_STREAM_END)
+			comp_len = stateZ.total_out;
+	}
+	// Chunks which didn't compress are written from stateRaw
+	stateCompLen[slot] = comp_len < 0 ? len : comp_len;
+	stateSum[slot] = adler32(adler32(0, Z_NULL, 0),
+	                         comp_len < 0 ? stateRaw[slot] : stateComp[slot],
+	                         stateCompLen[slot]);
+}
+
+static int state_decode(int slot){
+	unsigned int len = stateRawLen[slot], comp_len = stateCompLen[slot];
+
+	// Stored chunks are already in stateRaw
+	if(comp_len == len) return 1;
+
+	if(stateCodec == STATE_CODEC_LZ4)
+		return lz4_decompress(stateIn[slot], comp_len, stateRaw[slot], len) == len;
+
+	inflateReset(&stateZ);
+	stateZ.next_in   = stateIn[slot];
+	stateZ.avail_in  = comp_len;
+	stateZ.next_out  = stateRaw[slot];
+	stateZ.avail_out = len;
+	return inflate(&stateZ, Z_FINISH) == Z_STREAM_END && !stateZ.avail_out;
+}
+
+static void* state_thread(void* arg){
+	while(1){
+		LWP_SemWait(stateJob);
+		int slot = stateWorked++ & 1;
+		if(stateLoading) stateOK[slot] = state_decode(slot);
+		else state_encode(slot);
+		LWP_SemPost(stateDone[slot]);
+	}
+	return NULL;
+}
+
+static int state_begin(int loading, int codec){
+	int i;
+	if(stateThread == LWP_THREAD_NULL){
+		LWP_SemInit(&stateJob, 0, 2);
+		LWP_SemInit(&stateDone[0], 0, 1);
+		LWP_SemInit(&stateDone[1], 0, 1);
+		LWP_CreateThread(&stateThread, state_thread, NULL, NULL, 0, STATE_PRIORITY);
+	}
+
+	stateLoading = loading;
+	stateCodec   = codec;
+	stateError   = 0;
+	stateChunks = stateWorked = stateWritten = stateFill = 0;
+	stateCurrent = -1;
+	stateTOC = stateStage = NULL;
+
+	memset(&stateZ, 0, sizeof(z_stream));
+	if(codec == STATE_CODEC_ZLIB &&
+	   (loading ? inflateInit(&stateZ) : deflateInit(&stateZ, Z_BEST_SPEED)) != Z_OK)
+		return 0;
+	for(i=0; i<2; ++i){
+		stateRaw[i]  = malloc(STATE_CHUNK_SIZE);
+		stateComp[i] = malloc(STATE_CHUNK_SIZE);
+	}
+	return stateRaw[0] && stateRaw[1] && stateComp[0] && stateComp[1];
+}
+
+static void state_end(void){
+	int i;
+	if(stateCodec == STATE_CODEC_ZLIB){
+		if(stateLoading) inflateEnd(&stateZ);
+		else deflateEnd(&stateZ);
+	}
+	for(i=0; i<2; ++i){
+		free(stateRaw[i]);  stateRaw[i]  = NULL;
+		free(stateComp[i]); stateComp[i] = NULL;
+	}
+	free(stateTOC); stateTOC = NULL;
+	free(stateStage); stateStage = NULL;
+}
+
+// Saving: waits for the oldest chunk with the worker and writes it out
+static void state_write_next(void){
+	int slot = stateWritten & 1;
+	unsigned char* data;
+
+	LWP_SemWait(stateDone[slot]);
+	data = stateCompLen[slot] < stateRawLen[slot] ? stateComp[slot] : stateRaw[slot];
+	if(fwrite(data, 1, stateCompLen[slot], stateFile) != stateCompLen[slot])
+		stateError = 1;
+
+	if(!(stateWritten & 15) && !stateError){
+		unsigned char* toc = realloc(stateTOC, (stateWritten + 16) * STATE_TOC_ENTRY);
+		if(toc) stateTOC = toc;
+		else stateError = 1;
+	}
+	if(!stateError){
+		unsigned char* entry = stateTOC + stateWritten * STATE_TOC_ENTRY;
+		put_be32(entry,   stateRawLen[slot]);
+		put_be32(entry+4, stateCompLen[slot]);
+		put_be32(entry+8, stateOffset);
+		put_be32(entry+12, stateSum[slot]);
+	}
+	stateOffset += stateCompLen[slot];
+	++stateWritten;
+}
+
+static void state_submit(void){
+	stateRawLen[stateChunks & 1] = stateFill;
+	++stateChunks;
+	stateFill = 0;
+	LWP_SemPost(stateJob);
+	// The other buffer is reused once its chunk has been written
+	if(stateChunks - stateWritten > 1) state_write_next();
+}
+
+static void state_write(const void* src, unsigned int len){
+	const unsigned char* p = src;
+	while(len){
+		unsigned int count = STATE_CHUNK_SIZE - stateFill;
+		if(count > len) count = len;
+		memcpy(stateRaw[stateChunks & 1] + stateFill, p, count);
+		stateFill += count; p += count; len -= count;
+		if(stateFill == STATE_CHUNK_SIZE) state_submit();
+	}
+}
+
+static unsigned long state_sum(const unsigned char* data, unsigned int len){
+	return adler32(adler32(0, Z_NULL, 0), data, len);
+}
+
+/* Loading: reads in the TOC and every chunk and checks them against their
+ * checksums before any of the state is applied.  The chunks are kept in
+ * stateStage so the card is only read once; if there isn't room for them,
+ * they're read again as they're decoded.  A state which passes is exactly
+ * what was saved, so it can't fail to decode halfway through loading.
+ */
+static int state_check(unsigned int toc_offset, unsigned long toc_sum){
+	unsigned int i, file_len, raw_len, comp_len, offset;
+	unsigned char *entry, *data;
+
+	if((stateCodec != STATE_CODEC_ZLIB && stateCodec != STATE_CODEC_LZ4) ||
+	   fseek(stateFile, 0, SEEK_END))
+		return 0;
+	file_len = ftell(stateFile);
+	// The TOC has to fit in the file, which also keeps its size from wrapping
+	if(!stateNumChunks || stateNumChunks > STATE_MAX_CHUNKS ||
+	   toc_offset < STATE_HEADER_SIZE || toc_offset > file_len ||
+	   stateNumChunks > (file_len - toc_offset) / STATE_TOC_ENTRY)
+		return 0;
+	stateTOC = malloc(stateNumChunks * STATE_TOC_ENTRY);
+	if(!stateTOC || fseek(stateFile, toc_offset, SEEK_SET) ||
+	   fread(stateTOC, STATE_TOC_ENTRY, stateNumChunks, stateFile) != stateNumChunks ||
+	   state_sum(stateTOC, stateNumChunks * STATE_TOC_ENTRY) != toc_sum)
+		return 0;
+
+	// The chunks lie between the header and the TOC
+	stateStage = malloc(toc_offset - STATE_HEADER_SIZE);
+	if(stateStage &&
+	   (fseek(stateFile, STATE_HEADER_SIZE, SEEK_SET) ||
+	    fread(stateStage, 1, toc_offset - STATE_HEADER_SIZE, stateFile) != toc_offset - STATE_HEADER_SIZE))
+		return 0;
+
+	for(i=0; i<stateNumChunks; ++i){
+		entry    = stateTOC + i * STATE_TOC_ENTRY;
+		raw_len  = get_be32(entry);
+		comp_len = get_be32(entry+4);
+		offset   = get_be32(entry+8);
+		if(!raw_len || raw_len > STATE_CHUNK_SIZE || comp_len > raw_len ||
+		   offset < STATE_HEADER_SIZE || offset > toc_offset ||
+		   comp_len > toc_offset - offset)
+			return 0;
+		data = stateStage ? stateStage + offset - STATE_HEADER_SIZE : stateComp[0];
+		if(!stateStage &&
+		   (fseek(stateFile, offset, SEEK_SET) || fread(data, 1, comp_len, stateFile) != comp_len))
+			return 0;
+		if(state_sum(data, comp_len) != get_be32(entry+12))
+			return 0;
+	}
+	return 1;
+}
+
+// Loading: reads the next chunk in and hands it to the worker
+static void state_fetch(void){
+	int slot = stateChunks & 1;
+	unsigned char* entry = stateTOC + stateChunks * STATE_TOC_ENTRY;
+	unsigned int raw_len  = get_be32(entry);
+	unsigned int comp_len = get_be32(entry+4);
+	unsigned int offset   = get_be32(entry+8);
+
+	// Stored chunks are read out of stateRaw
+	stateIn[slot] = comp_len == raw_len ? stateRaw[slot] : stateComp[slot];
+	if(stateStage){
+		if(comp_len == raw_len)
+			memcpy(stateRaw[slot], stateStage + offset - STATE_HEADER_SIZE, raw_len);
+		else
+			stateIn[slot] = stateStage + offset - STATE_HEADER_SIZE;
+	} else if(fseek(stateFile, offset, SEEK_SET) ||
+	          fread(stateIn[slot], 1, comp_len, stateFile) != comp_len ||
+	          state_sum(stateIn[slot], comp_len) != get_be32(entry+12)){
+		stateError = 1;
+		raw_len = comp_len = 0;
+	}
+	stateRawLen[slot]  = raw_len;
+	stateCompLen[slot] = comp_len;
+	++stateChunks;
+	LWP_SemPost(stateJob);
+}
+
+static int state_next_chunk(void){
+	// The slot just drained takes the chunk after the one the worker has
+	if(stateCurrent >= 0 && stateChunks < stateNumChunks) state_fetch();
+	if(++stateCurrent >= stateNumChunks) return 0;
+	LWP_SemWait(stateDone[stateCurrent & 1]);
+	stateFill = 0;
+	return stateOK[stateCurrent & 1];
+}
+
+static void state_read(void* dst, unsigned int len){
+	unsigned char* p = dst;
+	while(len){
+		if(!stateError &&
+		   (stateCurrent < 0 || stateFill == stateRawLen[stateCurrent & 1]) &&
+		   (!state_next_chunk() || !stateRawLen[stateCurrent & 1]))
+			stateError = 1;
+		if(stateError){
+			// Truncated or corrupt, don't leave garbage behind
+			memset(p, 0, len);
+			return;
+		}
+		unsigned int count = stateRawLen[stateCurrent & 1] - stateFill;
+		if(count > len) count = len;
+		memcpy(p, stateRaw[stateCurrent & 1] + stateFill, count);
+		stateFill += count; p += count; len -= count;
+	}
+}
+
+static void state_write_tlb(unsigned int (*get)(unsigned int page)){
+	unsigned int page, value;
+	for(page=0; page<0x100000; ++page){
+		value = get(page);
+		if(!value) continue;
+		state_write(&page, 4);
+		state_write(&value, 4);
+	}
+	page = 0xFFFFFFFF;
+	state_write(&page, 4);
+}
+
+static void state_read_tlb(void (*set)(unsigned int page, unsigned int val)){
+	unsigned int page, value;
+	while(1){
+		state_read(&page, 4);
+		if(page >= 0x100000 || stateError) break;
+		state_read(&value, 4);
+		set(page, value);
+	}
+}
+
+#ifndef USE_TLB_CACHE
+static unsigned int tlb_get_r(unsigned int page){ return tlb_LUT_r[page]; }
+static unsigned int tlb_get_w(unsigned int page){ return tlb_LUT_w[page]; }
+static void tlb_set_r(unsigned int page, unsigned int val){ tlb_LUT_r[page] = val; }
+static void tlb_set_w(unsigned int page, unsigned int val){ tlb_LUT_w[page] = val; }
+#else
+#define tlb_get_r TLBCache_get_r
+#define tlb_get_w TLBCache_get_w
+#define tlb_set_r TLBCache_set_r
+#define tlb_set_w TLBCache_set_w
+#endif
+
+// The TLB LUTs follow from tlb_e, so in-memory snapshots rebuild them
+static void tlb_unmap(tlb* e)
+{
+	unsigned int i;
+	if(e->v_even)
+		for(i=e->start_even>>12; i<=e->end_even>>12; i++){
+			tlb_set_r(i, 0);
+			if(e->d_even) tlb_set_w(i, 0);
+			invalid_code_set(i, 1);
+		}
+	if(e->v_odd)
+		for(i=e->start_odd>>12; i<=e->end_odd>>12; i++){
+			tlb_set_r(i, 0);
+			if(e->d_odd) tlb_set_w(i, 0);
+			invalid_code_set(i, 1);
+		}
+}
+
+static void tlb_map_range(unsigned long start, unsigned long end, unsigned long phys, int dirty)
+{
+	unsigned int i, val;
+	if(start >= end || (start >= 0x80000000 && end < 0xC0000000) || phys >= 0x20000000)
+		return;
+	for(i=start>>12; i<=end>>12; i++){
+		val = 0x80000000 | (phys + (i<<12) - start);
+		tlb_set_r(i, val);
+		if(dirty) tlb_set_w(i, val);
+		invalid_code_set(i, 1);
+	}
+}
+
+#define put(src, n) do { memcpy(buf+len, src, n); len += n; } while(0)
+#define get(dst, n) do { memcpy(dst, buf+len, n); len += n; } while(0)
+
+int savestates_save_regs(char* buf)
+{
+	int len = 0;
+	put(&rdram_register, sizeof(RDRAM_register));
+	put(&MI_register, sizeof(mips_register));
+	put(&pi_register, sizeof(PI_register));
+	put(&sp_register, sizeof(SP_register));
+	put(&rsp_register, sizeof(RSP_register));
+	put(&si_register, sizeof(SI_register));
+	put(&vi_register, sizeof(VI_register));
+	put(&ri_register, sizeof(RI_register));
+	put(&ai_register, sizeof(AI_register));
+	put(&dpc_register, sizeof(DPC_register));
+	put(&dps_register, sizeof(DPS_register));
+	put(PIF_RAM, 0x40);
+	save_flashram_infos(buf+len);
+	len += 24;
+	put(&llbit, 4);
+	put(reg, sizeof(reg));	// hi and lo are in here
+	put(reg_cop0, sizeof(reg_cop0));
+	put(reg_cop1_fgr_64, sizeof(reg_cop1_fgr_64));
+	put(&FCR0, 4);
+	put(&FCR31, 4);
+	put(tlb_e, sizeof(tlb_e));
+	put(&interp_addr, 4);
+	put(&next_interupt, 4);
+	put(&next_vi, 4);
+	put(&vi_field, 4);
+	len += save_eventqueue_infos(buf+len);
+	return len;
+}
+
+void savestates_load_regs(char* buf)
+{
+	tlb old_e[32];
+	int len = 0, i;
+	memcpy(old_e, tlb_e, sizeof(tlb_e));
+
+	get(&rdram_register, sizeof(RDRAM_register));
+	get(&MI_register, sizeof(mips_register));
+	get(&pi_register, sizeof(PI_register));
+	get(&sp_register, sizeof(SP_register));
+	get(&rsp_register, sizeof(RSP_register));
+	get(&si_register, sizeof(SI_register));
+	get(&vi_register, sizeof(VI_register));
+	get(&ri_register, sizeof(RI_register));
+	get(&ai_register, sizeof(AI_register));
+	get(&dpc_register, sizeof(DPC_register));
+	get(&dps_register, sizeof(DPS_register));
+	get(PIF_RAM, 0x40);
+	load_flashram_infos(buf+len);
+	len += 24;
+	get(&llbit, 4);
+	get(reg, sizeof(reg));
+	get(reg_cop0, sizeof(reg_cop0));
+	get(reg_cop1_fgr_64, sizeof(reg_cop1_fgr_64));
+	get(&FCR0, 4);
+	get(&FCR31, 4);
+	get(tlb_e, sizeof(tlb_e));
+	get(&interp_addr, 4);
+	get(&next_interupt, 4);
+	get(&next_vi, 4);
+	get(&vi_field, 4);
+	load_eventqueue_infos(buf+len);
+	last_addr = interp_addr;
+
+	// Usually the TLB hasn't changed between snapshots
+	if(memcmp(old_e, tlb_e, sizeof(tlb_e))){
+		for(i=0; i<32; i++) tlb_unmap(&old_e[i]);
+		for(i=0; i<32; i++){
+			if(tlb_e[i].v_even)
+				tlb_map_range(tlb_e[i].start_even, tlb_e[i].end_even,
+				              tlb_e[i].phys_even, tlb_e[i].d_even);
+			if(tlb_e[i].v_odd)
+				tlb_map_range(tlb_e[i].start_odd, tlb_e[i].end_odd,
+				              tlb_e[i].phys_odd, tlb_e[i].d_odd);
+		}
+	}
+}
+
+#undef put
+#undef get
+
+static void savestates_filename(char* filename)
+{
+  /* fix the filename to %s.st%d format */
+#ifdef HW_RVL
+  sprintf(filename, "%s%s%s%s.st%d",(saveStateDevice==SAVESTATEDEVICE_USB)?"usb:":"sd:",
+                           statespath, ROM_SETTINGS.goodname, saveregionstr(),savestates_slot);
+#else
+  sprintf(filename, "sd:%s%s%s.st%d", statespath, ROM_SETTINGS.goodname, saveregionstr(),savestates_slot);
+#endif
+}
+
 void savestates_select_slot(unsigned int s)
 {
    if (s > 9) return;
@@ -65,46 +538,40 @@ void savestates_select_slot(unsigned int s)
 //returns 0 on file not existing
 int savestates_exists(int mode)
 {
-  gzFile f;
+  FILE* f;
 	char *filename;
   filename = malloc(1024);
-#ifdef HW_RVL
-  sprintf(filename, "%s%s%s%s.st%d",(saveStateDevice==SAVESTATEDEVICE_USB)?"usb:":"sd:",
-                           statespath, ROM_SETTINGS.goodname, saveregionstr(),savestates_slot);
-#else
-  sprintf(filename, "sd:%s%s%s.st%d", statespath, ROM_SETTINGS.goodname, saveregionstr(),savestates_slot);
-#endif
+  savestates_filename(filename);
 
-	f = gzopen(filename, (mode == SAVESTATE) ? "wb" : "rb");
+	f = fopen(filename, (mode == SAVESTATE) ? "wb" : "rb");
   free(filename);
    	
   if(!f) {
     return 0;
   }
-  gzclose(f);
+  fclose(f);
   return 1;
 }
 
 void savestates_save()
 { 
-  gzFile f;
 	char *filename, buf[1024];
+	unsigned char header[STATE_HEADER_SIZE];
   int len, i;
 	
-  /* fix the filename to %s.st%d format */
+  // Don't clobber the slot unless the state can actually be written
+  if(!state_begin(0, saveStateCodec == SAVESTATECODEC_LZ4 ? STATE_CODEC_LZ4 : STATE_CODEC_ZLIB)) {
+    state_end();
+    return;
+  }
   filename = malloc(1024);
-#ifdef HW_RVL
-  sprintf(filename, "%s%s%s%s.st%d",(saveStateDevice==SAVESTATEDEVICE_USB)?"usb:":"sd:",
-                           statespath, ROM_SETTINGS.goodname, saveregionstr(),savestates_slot);
-#else
-  sprintf(filename, "sd:%s%s%s.st%d", statespath, ROM_SETTINGS.goodname, saveregionstr(),savestates_slot);
-#endif
-
+  savestates_filename(filename);
 
-	f = gzopen(filename, "wb");
+	stateFile = fopen(filename, "wb");
   free(filename);
    	
-  if(!f) {
+  if(!stateFile) {
+    state_end();
   	return;
 	}
   if(stop) {
@@ -112,57 +579,72 @@ void savestates_save()
   }
   else {
     pauseAudio();
-  }  
-  gzwrite(f, &rdram_register, sizeof(RDRAM_register));
-	gzwrite(f, &MI_register, sizeof(mips_register));
-	gzwrite(f, &pi_register, sizeof(PI_register));
-	gzwrite(f, &sp_register, sizeof(SP_register));
-	gzwrite(f, &rsp_register, sizeof(RSP_register));
-	gzwrite(f, &si_register, sizeof(SI_register));
-	gzwrite(f, &vi_register, sizeof(VI_register));
-	gzwrite(f, &ri_register, sizeof(RI_register));
-	gzwrite(f, &ai_register, sizeof(AI_register));
-	gzwrite(f, &dpc_register, sizeof(DPC_register));
-	gzwrite(f, &dps_register, sizeof(DPS_register));
+  }
+  // The header goes in last, once the chunks and TOC are known
+  memset(header, 0, STATE_HEADER_SIZE);
+  fwrite(header, 1, STATE_HEADER_SIZE, stateFile);
+  stateOffset = STATE_HEADER_SIZE;
+
+  state_write(&rdram_register, sizeof(RDRAM_register));
+	state_write(&MI_register, sizeof(mips_register));
+	state_write(&pi_register, sizeof(PI_register));
+	state_write(&sp_register, sizeof(SP_register));
+	state_write(&rsp_register, sizeof(RSP_register));
+	state_write(&si_register, sizeof(SI_register));
+	state_write(&vi_register, sizeof(VI_register));
+	state_write(&ri_register, sizeof(RI_register));
+	state_write(&ai_register, sizeof(AI_register));
+	state_write(&dpc_register, sizeof(DPC_register));
+	state_write(&dps_register, sizeof(DPS_register));
 #ifdef USE_EXPANSION
-	gzwrite(f, rdram, 0x800000);
+	state_write(rdram, 0x800000);
 #else
-  gzwrite(f, rdram, 0x400000);
+  state_write(rdram, 0x400000);
 #endif
-	gzwrite(f, SP_DMEM, 0x1000);
-	gzwrite(f, SP_IMEM, 0x1000);
-	gzwrite(f, PIF_RAM, 0x40);
+	state_write(SP_DMEM, 0x1000);
+	state_write(SP_IMEM, 0x1000);
+	state_write(PIF_RAM, 0x40);
 	
 	save_flashram_infos(buf);
-	gzwrite(f, buf, 24);
-#ifndef USE_TLB_CACHE
-	gzwrite(f, tlb_LUT_r, 0x100000);		
-	gzwrite(f, tlb_LUT_w, 0x100000);
-#else
-	//Traverse the TLB cache hash	and dump it
-  TLBCache_dump_r(f);
-	TLBCache_dump_w(f);
-#endif
+	state_write(buf, 24);
+	state_write_tlb(tlb_get_r);
+	state_write_tlb(tlb_get_w);
+
+	state_write(&llbit, 4);
+	state_write(reg, 32*8);
+	for (i=0; i<32; i++) state_write(reg_cop0+i, 8); // *8 for compatibility with old versions purpose
+	state_write(&lo, 8);
+	state_write(&hi, 8);
+	state_write(reg_cop1_fgr_64, 32*8);
+	state_write(&FCR0, 4);
+	state_write(&FCR31, 4);
+	state_write(tlb_e, 32*sizeof(tlb));
+	state_write(&interp_addr, 4);    //Dynarec should be ok with just this
 
-	gzwrite(f, &llbit, 4);
-	gzwrite(f, reg, 32*8);
-	for (i=0; i<32; i++) gzwrite(f, reg_cop0+i, 8); // *8 for compatibility with old versions purpose
-	gzwrite(f, &lo, 8);
-	gzwrite(f, &hi, 8);
-	gzwrite(f, reg_cop1_fgr_64, 32*8);
-	gzwrite(f, &FCR0, 4);
-	gzwrite(f, &FCR31, 4);
-	gzwrite(f, tlb_e, 32*sizeof(tlb));
-	gzwrite(f, &interp_addr, 4);    //Dynarec should be ok with just this
-
-	gzwrite(f, &next_interupt, 4);
-	gzwrite(f, &next_vi, 4);
-	gzwrite(f, &vi_field, 4);
+	state_write(&next_interupt, 4);
+	state_write(&next_vi, 4);
+	state_write(&vi_field, 4);
 	
 	len = save_eventqueue_infos(buf);
-	gzwrite(f, buf, len);
-	
-	gzclose(f);
+	state_write(buf, len);
+
+	if(stateFill) state_submit();
+	while(stateWritten < stateChunks) state_write_next();
+	if(!stateError && fwrite(stateTOC, STATE_TOC_ENTRY, stateWritten, stateFile) != stateWritten)
+		stateError = 1;
+
+	// A state which couldn't be written out has no chunks, so it won't load
+	put_be32(header,    STATE_MAGIC);
+	put_be32(header+4,  STATE_VERSION);
+	put_be32(header+8,  stateCodec);
+	put_be32(header+12, stateError ? 0 : stateWritten);
+	put_be32(header+16, stateOffset);
+	put_be32(header+20, stateError ? 0 : state_sum(stateTOC, stateWritten * STATE_TOC_ENTRY));
+	fseek(stateFile, 0, SEEK_SET);
+	fwrite(header, 1, STATE_HEADER_SIZE, stateFile);
+
+	state_end();
+	fclose(stateFile);
 	if(stop) {
 	  continueRemovalThread();
   }
@@ -171,33 +653,12 @@ void savestates_save()
   }
 }
 
-void savestates_load()
+// States saved before the chunked format are a single gzip stream
+static void savestates_load_gz(gzFile f)
 {
-	gzFile f = NULL;
-	char *filename, buf[1024];
+	char buf[1024];
 	int len, i;
-		
-	/* fix the filename to %s.st%d format */
-  filename = malloc(1024);
-#ifdef HW_RVL
-  sprintf(filename, "%s%s%s%s.st%d",(saveStateDevice==SAVESTATEDEVICE_USB)?"usb:":"sd:",
-                           statespath, ROM_SETTINGS.goodname, saveregionstr(),savestates_slot);
-#else
-  sprintf(filename, "sd:%s%s%s.st%d", statespath, ROM_SETTINGS.goodname, saveregionstr(),savestates_slot);
-#endif
-	
-	f = gzopen(filename, "rb");
-	free(filename);
-	
-	if (!f) {
-		return;
-	}
-	if(stop) {
-	  pauseRemovalThread();
-  }
-  else {
-    pauseAudio();
-  }
+
   gzread(f, &rdram_register, sizeof(RDRAM_register));
 	gzread(f, &MI_register, sizeof(mips_register));
 	gzread(f, &pi_register, sizeof(PI_register));
@@ -271,8 +732,142 @@ void savestates_load()
 		len += 8;
 	}
 	load_eventqueue_infos(buf);
+}
+
+// The chunks have been through state_check by now
+static int savestates_load_chunked(void)
+{
+	char buf[1024];
+	int len, i;
+	unsigned int n;
+
+	// Keep both buffers busy: the worker decodes one while the other is read
+	for(n=0; n<2 && n<stateNumChunks; ++n) state_fetch();
+
+	state_read(&rdram_register, sizeof(RDRAM_register));
+	state_read(&MI_register, sizeof(mips_register));
+	state_read(&pi_register, sizeof(PI_register));
+	state_read(&sp_register, sizeof(SP_register));
+	state_read(&rsp_register, sizeof(RSP_register));
+	state_read(&si_register, sizeof(SI_register));
+	state_read(&vi_register, sizeof(VI_register));
+	state_read(&ri_register, sizeof(RI_register));
+	state_read(&ai_register, sizeof(AI_register));
+	state_read(&dpc_register, sizeof(DPC_register));
+	state_read(&dps_register, sizeof(DPS_register));
+#ifdef USE_EXPANSION
+	state_read(rdram, 0x800000);
+#else
+	state_read(rdram, 0x400000);
+#endif
+	state_read(SP_DMEM, 0x1000);
+	state_read(SP_IMEM, 0x1000);
+	state_read(PIF_RAM, 0x40);
+	state_read(buf, 24);
+	load_flashram_infos(buf);
+
+#ifndef USE_TLB_CACHE
+	memset(tlb_LUT_r, 0, 0x100000*sizeof(unsigned long));
+	memset(tlb_LUT_w, 0, 0x100000*sizeof(unsigned long));
+#else
+	TLBCache_deinit();
+	TLBCache_init();
+#endif
+	state_read_tlb(tlb_set_r);
+	state_read_tlb(tlb_set_w);
+
+	state_read(&llbit, 4);
+	state_read(reg, 32*8);
+	for (i=0; i<32; i++) 
+	{
+		state_read(reg_cop0+i, 4);
+		state_read(buf, 4); // for compatibility with old versions purpose
+	}
+	state_read(&lo, 8);
+	state_read(&hi, 8);
+	state_read(reg_cop1_fgr_64, 32*8);
+	state_read(&FCR0, 4);
+	state_read(&FCR31, 4);
+	state_read(tlb_e, 32*sizeof(tlb));
+	state_read(&interp_addr, 4);       //dynarec should be ok with just this
+	state_read(&next_interupt, 4);
+	state_read(&next_vi, 4);
+	state_read(&vi_field, 4);
+
+	len = 0;
+	while(!stateError)
+	{
+		state_read(buf+len, 4);
+		if (*((unsigned long*)&buf[len]) == 0xFFFFFFFF) break;
+		// No room left for the end of the queue
+		if (len + 12 > sizeof(buf)) stateError = 1;
+		state_read(buf+len+4, 4);
+		len += 8;
+	}
+	if(!stateError) load_eventqueue_infos(buf);
+
+	for(n=stateCurrent+1; n<stateChunks; ++n) LWP_SemWait(stateDone[n & 1]);
+	return !stateError;
+}
+
+int savestates_load()
+{
+	gzFile f = NULL;
+	char *filename;
+	unsigned char header[STATE_HEADER_SIZE];
+	int loaded = 1;
+		
+  filename = malloc(1024);
+  savestates_filename(filename);
 	
-	gzclose(f);
+	stateFile = fopen(filename, "rb");
+	if (!stateFile) {
+		free(filename);
+		return 0;
+	}
+	if(fread(header, 1, STATE_HEADER_SIZE, stateFile) != STATE_HEADER_SIZE ||
+	   get_be32(header) != STATE_MAGIC){
+		fclose(stateFile);
+		f = gzopen(filename, "rb");
+		free(filename);
+		if (!f) {
+			return 0;
+		}
+	} else {
+		free(filename);
+		stateNumChunks = get_be32(header+12);
+		if(get_be32(header+4) != STATE_VERSION ||
+		   !state_begin(1, get_be32(header+8))){
+			state_end();
+			fclose(stateFile);
+			return 0;
+		}
+		if(!state_check(get_be32(header+16), get_be32(header+20))){
+			DEBUG_print("Savestate is truncated or corrupt, not loaded\n", DBG_USBGECKO);
+			state_end();
+			fclose(stateFile);
+			return 0;
+		}
+	}
+	if(stop) {
+	  pauseRemovalThread();
+  }
+  else {
+    pauseAudio();
+  }
+
+	if(f) {
+		savestates_load_gz(f);
+		gzclose(f);
+	} else {
+		loaded = savestates_load_chunked();
+		state_end();
+		fclose(stateFile);
+		if(!loaded)
+			DEBUG_print("Savestate failed to decode, only partly loaded\n", DBG_USBGECKO);
+	}
+	// All of RDRAM was replaced: nothing unmapped by the TLB can be trusted
+	rdram_page_written(0, CODE_RDRAM_SIZE);
 	last_addr = interp_addr;
 	if(stop) {
 	  continueRemovalThread();
@@ -280,4 +875,5 @@ void savestates_load()
   else {
     resumeAudio();
   }
+  return loaded;
 }
@@ -148,6 +148,78 @@ enum loadButtonSlot
 	LOADBUTTON_DEFAULT
 };
 
+extern char romReadAhead;	//ROM cache blocks loaded ahead of streaming reads
+enum romReadAhead
+{
+	ROMREADAHEAD_DISABLE=0,
+	ROMREADAHEAD_DEFAULT=2,
+	ROMREADAHEAD_MAX=8
+};
+
+extern char saveStateCodec;	//Compression used for new savestates
+enum saveStateCodec
+{
+	SAVESTATECODEC_ZLIB=0,
+	SAVESTATECODEC_LZ4
+};
+
+extern char rewindEnabled;
+enum rewindEnabled
+{
+	REWIND_DISABLE=0,
+	REWIND_ENABLE
+};
+
+extern char rewindInterval;	//VIs between rewind snapshots
+enum rewindInterval
+{
+	REWINDINTERVAL_MIN=1,
+	REWINDINTERVAL_DEFAULT=10,
+	REWINDINTERVAL_MAX=60
+};
+
+extern char rewindDepth;	//Most rewind snapshots kept
+enum rewindDepth
+{
+	REWINDDEPTH_MIN=1,
+	REWINDDEPTH_DEFAULT=60,
+	REWINDDEPTH_MAX=120
+};
+
+extern char rewindBudget;	//MB of memory rewind snapshots may use
+enum rewindBudget
+{
+	REWINDBUDGET_MIN=1,
+#ifdef HW_RVL
+	REWINDBUDGET_DEFAULT=16,
+#else
+	REWINDBUDGET_DEFAULT=4,
+#endif
+	REWINDBUDGET_MAX=32
+};
+
+extern char runAheadFrames;	//Frames emulated ahead of the one shown
+enum runAheadFrames
+{
+	RUNAHEAD_DISABLE=0,
+	RUNAHEAD_MAX=3
+};
+
+extern char audioTaskDelay;	//Thousands of Count cycles added to an audio task's SP interrupt, for it to run in the background
+enum audioTaskDelay
+{
+	AUDIOTASKDELAY_SYNC=0,
+	AUDIOTASKDELAY_MAX=100
+};
+
+extern char audioLatency;	//Milliseconds of audio the output rate is steered to keep buffered
+enum audioLatency
+{
+	AUDIOLATENCY_FIXED=0,
+	AUDIOLATENCY_DEFAULT=40,
+	AUDIOLATENCY_MAX=100
+};
+
 
 //#ifdef GLN64_GX
 extern char glN64_useFrameBufferTextures;
@@ -33,6 +33,7 @@ extern "C" {
 #include "../main/rom.h"
 #include "../main/plugin.h"
 #include "../main/savestates.h"
+#include "../main/rewind.h"
 #include "../fileBrowser/fileBrowser.h"
 #include "../fileBrowser/fileBrowser-libfat.h"
 #include "../fileBrowser/fileBrowser-CARD.h"
@@ -45,20 +46,22 @@ void Func_SaveGame();
 void Func_LoadState();
 void Func_SaveState();
 void Func_StateCycle();
+void Func_Rewind();
 void Func_ReturnFromCurrentRomFrame();
 
-#define NUM_FRAME_BUTTONS 7
+#define NUM_FRAME_BUTTONS 8
 #define FRAME_BUTTONS currentRomFrameButtons
 #define FRAME_STRINGS currentRomFrameStrings
 
-static char FRAME_STRINGS[7][25] =
+static char FRAME_STRINGS[8][25] =
 	{ "Show ROM Info",
 	  "Restart Game",
 	  "Load Save File",
 	  "Save Game",
 	  "Load State",
 	  "Save State",
-	  "Slot 0"};
+	  "Slot 0",
+	  "Rewind"};
 
 struct ButtonInfo
 {
@@ -83,7 +86,8 @@ struct ButtonInfo
 	{	NULL,	BTN_A_NRM,	FRAME_STRINGS[3],	150.0,	240.0,	340.0,	56.0,	 2,	 4,	-1,	-1,	Func_SaveGame,		Func_ReturnFromCurrentRomFrame }, // Save Native Save
 	{	NULL,	BTN_A_NRM,	FRAME_STRINGS[4],	150.0,	300.0,	220.0,	56.0,	 3,	 5,	 6,	 6,	Func_LoadState,		Func_ReturnFromCurrentRomFrame }, // Load State 
 	{	NULL,	BTN_A_NRM,	FRAME_STRINGS[5],	150.0,	360.0,	220.0,	56.0,	 4,	 0,	 6,	 6,	Func_SaveState,		Func_ReturnFromCurrentRomFrame }, // Save State 
-	{	NULL,	BTN_A_NRM,	FRAME_STRINGS[6],	390.0,	330.0,	100.0,	56.0,	 3,	 0,	 4,	 4,	Func_StateCycle,	Func_ReturnFromCurrentRomFrame }, // Cycle State 
+	{	NULL,	BTN_A_NRM,	FRAME_STRINGS[6],	390.0,	330.0,	100.0,	56.0,	 3,	 7,	 4,	 4,	Func_StateCycle,	Func_ReturnFromCurrentRomFrame }, // Cycle State 
+	{	NULL,	BTN_A_NRM,	FRAME_STRINGS[7],	390.0,	390.0,	100.0,	56.0,	 6,	 0,	 5,	 5,	Func_Rewind,		Func_ReturnFromCurrentRomFrame }, // Rewind 
 };
 
 CurrentRomFrame::CurrentRomFrame()
@@ -221,6 +225,7 @@ void Func_LoadSave()
 	result += loadSram(saveFile_dir);
 	result += loadMempak(saveFile_dir);
 	result += loadFlashram(saveFile_dir);
+	result += saveJournal_open(saveFile_dir);
 	saveFile_deinit(saveFile_dir);
 
 	switch (nativeSaveDevice)
@@ -335,6 +340,19 @@ void Func_StateCycle()
 	FRAME_STRINGS[6][5] = which_slot + '0';
 }
 
+void Func_Rewind()
+{
+  if(rewindEnabled != REWIND_ENABLE) {
+    menu::MessageBox::getInstance().setMessage("Rewind is disabled");
+  }
+  else if(!rewind_request()) {
+    menu::MessageBox::getInstance().setMessage("Nothing to rewind to yet");
+  }
+  else {
+    menu::MessageBox::getInstance().setMessage("Gameplay will rewind once resumed");
+  }
+}
+
 void Func_ReturnFromCurrentRomFrame()
 {
 	pMenuContext->setActiveFrame(MenuContext::FRAME_MAIN);
@@ -247,6 +247,7 @@ void Func_PlayGame()
 	menu::Gui::getInstance().gfx->clearEFB((GXColor){0, 0, 0, 0xFF}, 0x000000);
 
 	pauseRemovalThread();
+	saveJournal_resume();
 	resumeAudio();
 	resumeInput();
 	menuActive = 0;
@@ -260,6 +261,7 @@ void Func_PlayGame()
 	menuActive = 1;
 	pauseInput();
 	pauseAudio();
+	saveJournal_pause();
   continueRemovalThread();
 	
   if(autoSave==AUTOSAVE_ENABLE) {
@@ -2,6 +2,8 @@
    by Mike Slegeir for Mupen64-GC / MEM2 ver by emu_kidid
  */
 
+#include <stdio.h>
+#include <string.h>
 #include "Invalid_Code.h"
 #ifndef HW_RVL  //GC use bit version
 
@@ -31,3 +33,99 @@ void inline invalid_code_set(int block_num, int value){
 
 #endif
 
+#ifdef PPC_DYNAREC
+#include "ppc/Recompile.h"
+#include "Recomp-Cache.h"
+#include "ARAM-blocks.h"
+#endif
+#include "../gui/DEBUG.h"
+
+// 4KB worth of bits covering all 8MB of RDRAM
+unsigned int code_chunks[CODE_CHUNK_COUNT/32];
+unsigned int rdram_page_gen[CODE_RDRAM_SIZE>>12];
+// How many times code was thrown out of each 4KB page by a write
+static unsigned int invalidation_counts[CODE_RDRAM_SIZE>>12];
+
+void invalid_code_mark(unsigned int paddr, unsigned int length){
+	unsigned int chunk, last;
+	if(paddr >= CODE_RDRAM_SIZE || !length) return;
+	if(paddr + length > CODE_RDRAM_SIZE) length = CODE_RDRAM_SIZE - paddr;
+
+	last = (paddr + length - 1) >> CODE_CHUNK_SHIFT;
+	for(chunk = paddr >> CODE_CHUNK_SHIFT; chunk <= last; ++chunk)
+		code_chunks[chunk>>5] |= 1<<(chunk&31);
+}
+
+void invalid_code_clear_chunks(void){
+	memset(code_chunks, 0, sizeof(code_chunks));
+}
+
+#ifdef PPC_DYNAREC
+// Free every func in the block at vaddr which overlaps [vaddr, vend)
+static int free_funcs_in_range(unsigned int vaddr, unsigned int vend){
+	PowerPC_block* block = blocks_get(vaddr>>12);
+	PowerPC_func* func, * last = NULL;
+	int freed = 0;
+	if(!block) return 0;
+
+	while((func = find_func_range(&block->funcs, vaddr, vend)) && func != last){
+		last = func;
+		RecompCache_Free(func->start_addr);
+		++freed;
+	}
+	return freed;
+}
+
+// Whether any func still occupies [vaddr, vend)
+static int has_funcs_in_range(unsigned int vaddr, unsigned int vend){
+	PowerPC_block* block = blocks_get(vaddr>>12);
+	return block && find_func_range(&block->funcs, vaddr, vend);
+}
+#endif
+
+void invalid_code_write(unsigned int paddr, unsigned int length){
+	unsigned int end, chunk, last;
+	if(paddr >= CODE_RDRAM_SIZE || !length) return;
+	end = paddr + length;
+	if(end > CODE_RDRAM_SIZE) end = CODE_RDRAM_SIZE;
+
+	last = (end - 1) >> CODE_CHUNK_SHIFT;
+	for(chunk = paddr >> CODE_CHUNK_SHIFT; chunk <= last; ++chunk){
+		if(!(code_chunks[chunk>>5] & (1<<(chunk&31)))){
+			// Skip over 32 empty chunks at a time for large DMAs
+			if(!code_chunks[chunk>>5]) chunk |= 31;
+			continue;
+		}
+
+		unsigned int c_start = chunk << CODE_CHUNK_SHIFT;
+		unsigned int c_end   = c_start + CODE_CHUNK_SIZE;
+#ifdef PPC_DYNAREC
+		unsigned int w_start = paddr > c_start ? paddr : c_start;
+		unsigned int w_end   = end < c_end ? end : c_end;
+		// Only the funcs which were actually written over are freed
+		int freed = free_funcs_in_range(0x80000000|w_start, 0x80000000|w_end)
+		          + free_funcs_in_range(0xa0000000|w_start, 0xa0000000|w_end);
+		if(freed) ++invalidation_counts[w_start>>12];
+		// Keep the chunk marked if other code still lives in it
+		if(has_funcs_in_range(0x80000000|c_start, 0x80000000|c_end) ||
+		   has_funcs_in_range(0xa0000000|c_start, 0xa0000000|c_end))
+			continue;
+#endif
+		code_chunks[chunk>>5] &= ~(1<<(chunk&31));
+	}
+}
+
+unsigned int invalid_code_get_count(unsigned int page){
+	return page < (CODE_RDRAM_SIZE>>12) ? invalidation_counts[page] : 0;
+}
+
+void invalid_code_dump_counts(void){
+	unsigned int page;
+	for(page = 0; page < (CODE_RDRAM_SIZE>>12); ++page){
+		if(!invalidation_counts[page]) continue;
+		sprintf(txtbuffer, "SMC: page %08x invalidated %u times\n",
+		        0x80000000 | (page<<12), invalidation_counts[page]);
+		DEBUG_print(txtbuffer, DBG_USBGECKO);
+	}
+}
+
@@ -8,4 +8,52 @@
 int inline invalid_code_get(int block_num);
 void inline invalid_code_set(int block_num, int value);
 
+/* Sub-page tracking of which parts of RDRAM hold recompiled code.
+   One bit per CODE_CHUNK_SIZE bytes of physical RDRAM lets stores and
+   DMAs skip the func lookup entirely unless they actually hit code.
+ */
+#define CODE_CHUNK_SHIFT 8
+#define CODE_CHUNK_SIZE  (1<<CODE_CHUNK_SHIFT)
+#define CODE_RDRAM_SIZE  0x800000
+#define CODE_CHUNK_COUNT (CODE_RDRAM_SIZE>>CODE_CHUNK_SHIFT)
+
+extern unsigned int code_chunks[CODE_CHUNK_COUNT/32];
+
+// Mark [paddr, paddr+length) as containing recompiled code
+void invalid_code_mark(unsigned int paddr, unsigned int length);
+// Free any funcs overlapping a write to [paddr, paddr+length)
+void invalid_code_write(unsigned int paddr, unsigned int length);
+// Forget all code chunks (all blocks are being invalidated)
+void invalid_code_clear_chunks(void);
+// Number of times code in the 4KB RDRAM page was invalidated by a write
+unsigned int invalid_code_get_count(unsigned int page);
+// Print the invalidation counts for every page that has been hit
+void invalid_code_dump_counts(void);
+
+/* Write generation of every 4KB page of RDRAM. Every store and DMA into
+   a page bumps its generation, so code which was unmapped by the TLB can
+   be revalidated by comparing a single counter instead of hashing.
+ */
+extern unsigned int rdram_page_gen[CODE_RDRAM_SIZE>>12];
+
+static inline void rdram_page_written(unsigned int paddr, unsigned int length){
+	unsigned int page = paddr >> 12, last;
+	if(paddr >= CODE_RDRAM_SIZE || !length) return;
+	last = (paddr + length - 1) >> 12;
+	if(last >= (CODE_RDRAM_SIZE>>12)) last = (CODE_RDRAM_SIZE>>12) - 1;
+	for(; page <= last; ++page) ++rdram_page_gen[page];
+}
+
+// Cheap write-side check: paddr is a physical RDRAM offset
+static inline void invalid_code_check_write(unsigned int paddr, unsigned int length){
+	unsigned int chunk = paddr >> CODE_CHUNK_SHIFT;
+	if(paddr >= CODE_RDRAM_SIZE || !length) return;
+	// Common case: a small store which lands in a single chunk
+	if(chunk == (paddr + length - 1) >> CODE_CHUNK_SHIFT &&
+	   !(code_chunks[chunk>>5] & (1<<(chunk&31))))
+		return;
+	invalid_code_write(paddr, length);
+}
+
 #endif
+
@@ -39,6 +39,8 @@
 #include "../main/plugin.h"
 #include "../main/guifuncs.h"
 #include "../main/savestates.h"
+#include "../main/rewind.h"
+#include "../main/runahead.h"
 #include "../gc_memory/memory.h"
 
 static int SPECIAL_done = 0;
@@ -329,9 +331,24 @@ void gen_interupt()
     dyna_stop();
   }
 
+  // Saving or loading needs the audio task's output in RDRAM
+  if (savestates_job) joinAudioTask_RSP();
+
   if (savestates_job & LOADSTATE) {
     savestates_load();
     savestates_job &= ~LOADSTATE;
+    runahead_init();
+    return;
+  }
+  if (savestates_job & REWINDSTATE) {
+    rewind_restore();
+    savestates_job &= ~REWINDSTATE;
+    runahead_init();
+    return;
+  }
+  if (savestates_job & RUNAHEADLOAD) {
+    runahead_restore();
+    savestates_job &= ~RUNAHEADLOAD;
     return;
   }
   if (skip_jump) {
@@ -365,16 +382,19 @@ void gen_interupt()
       return;
     break;
     case VI_INT:
-      updateScreen();
+      if (RUNAHEAD_SHOW_VIDEO) updateScreen();
 #ifdef PROFILE
       refresh_stat();
 #endif
-      new_vi();
+      // Frames run ahead don't count towards the VI limit
+      if (!runAheadPhase) new_vi();
       vi_register.vi_delay = (vi_register.vi_v_sync == 0) ? 500000 : ((vi_register.vi_v_sync + 1)*1500);
       next_vi += vi_register.vi_delay;
       vi_field = (vi_register.vi_status&0x40) ? 1-vi_field : 0; 
       remove_interupt_event();
       add_interupt_event_count(VI_INT, next_vi);
+      if (!runAheadPhase) rewind_new_vi();
+      runahead_new_vi();
   
       MI_register.mi_intr_reg |= 0x08;
       if(!chk_status(1)) {
@@ -438,6 +458,7 @@ void gen_interupt()
   
     case SP_INT:
       remove_interupt_event();
+      joinAudioTask_RSP();
       sp_register.sp_status_reg |= 0x303;
       sp_register.signal2 = 1;
       sp_register.broke = 1;
@@ -469,8 +490,19 @@ void gen_interupt()
   }
   exception_general();
    
+  // Only the real frame's state is saved, never one that was run ahead
+  if (runAheadPhase) return;
+
   if (savestates_job & SAVESTATE) {
     savestates_save();
     savestates_job &= ~SAVESTATE;
   }
+  if (savestates_job & REWINDSAVE) {
+    rewind_save();
+    savestates_job &= ~REWINDSAVE;
+  }
+  if (savestates_job & RUNAHEADSAVE) {
+    runahead_save();
+    savestates_job &= ~RUNAHEADSAVE;
+  }
 }
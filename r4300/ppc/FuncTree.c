@@ -44,6 +44,21 @@ PowerPC_func* find_func(PowerPC_func_node** root, unsigned int addr){
 	return node ? node->function : NULL;
 }
 
+PowerPC_func* find_func_range(PowerPC_func_node** root,
+                              unsigned int start, unsigned int end){
+	// Funcs in a block never overlap, so any node we hit is our answer
+	PowerPC_func_node* node = *root;
+	while(node){
+		if(end <= node->function->start_addr)
+			node = node->left;
+		else if(start >= node->function->end_addr)
+			node = node->right;
+		else
+			return node->function;
+	}
+	return NULL;
+}
+
 void insert_func(PowerPC_func_node** root, PowerPC_func* func){
 	PowerPC_func_node** node = _find(root, func->start_addr);
 	if(*node) return; // Avoid a memory leak if this function exists
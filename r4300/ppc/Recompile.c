@@ -272,6 +272,11 @@ PowerPC_func* recompile_block(PowerPC_block* ppc_block, unsigned int addr){
 	DCFlushRange(func->code, code_length*sizeof(PowerPC_instr));
 	ICInvalidateRange(func->code, code_length*sizeof(PowerPC_instr));
 
+	// Let stores and DMAs know that this part of RDRAM is now code
+	if(func->start_addr >= 0x80000000 && func->start_addr < 0xc0000000)
+		invalid_code_mark(func->start_addr & 0x1FFFFFFF,
+		                  func->end_addr - func->start_addr);
+
 	return func;
 }
 
@@ -284,6 +289,7 @@ void init_block(MIPS_instr* mips_code, PowerPC_block* ppc_block){
 		memset(ppc_block->code_addr, 0, length * sizeof(PowerPC_instr*));
 	}*/
 	ppc_block->mips_code = mips_code;
+	ppc_block->tlb_paddr = 0;
 
 	// FIXME: Equivalent addresses should point to the same code/funcs?
 	if(ppc_block->end_address < 0x80000000 || ppc_block->start_address >= 0xc0000000){
@@ -58,6 +58,9 @@ typedef struct func {
 } PowerPC_func;
 
 PowerPC_func* find_func(PowerPC_func_node** root, unsigned int addr);
+// Returns any func overlapping [start, end)
+PowerPC_func* find_func_range(PowerPC_func_node** root,
+                              unsigned int start, unsigned int end);
 void insert_func(PowerPC_func_node** root, PowerPC_func* func);
 void remove_func(PowerPC_func_node** root, PowerPC_func* func);
 
@@ -68,7 +71,8 @@ typedef struct {
 	//PowerPC_instr** code_addr;     // table of block offsets to code pointer,
 	                               //   its length is end_addr - start_addr
 	PowerPC_func_node* funcs;      // BST of functions in this block
-	unsigned long   adler32;       // Used for TLB
+	unsigned int    tlb_paddr;     // Physical page this was unmapped from
+	unsigned int    tlb_gen;       //   and its write generation (for TLB)
 } PowerPC_block;
 
 #define MAX_JUMPS        4096
@@ -230,17 +230,11 @@ unsigned int dyna_check_cop1_unusable(unsigned int pc, int isDelaySlot){
 	return interp_addr;
 }
 
-static void invalidate_func(unsigned int addr){
-	PowerPC_block* block = blocks_get(addr>>12);
-	PowerPC_func* func = find_func(&block->funcs, addr);
-	if(func)
-		RecompCache_Free(func->start_addr);
-}
-
-#define check_memory() \
-	if(!invalid_code_get(address>>12)/* && \
-	   blocks[address>>12]->code_addr[(address&0xfff)>>2]*/) \
-		invalidate_func(address);
+// address is physical (kseg0/1) after the write handler runs,
+//   so only stores which land on recompiled code do any real work
+#define check_memory(length) \
+	if(address >= 0x80000000 && address < 0xc0000000) \
+		invalid_code_check_write(address & 0x1FFFFFFF, length);
 
 unsigned int dyna_mem(unsigned int value, unsigned int addr,
                       memType type, unsigned int pc, int isDelaySlot){
@@ -291,32 +285,32 @@ unsigned int dyna_mem(unsigned int value, unsigned int addr,
 		case MEM_SW:
 			word = value;
 			write_word_in_memory();
-			check_memory();
+			check_memory(4);
 			break;
 		case MEM_SH:
 			hword = value;
 			write_hword_in_memory();
-			check_memory();
+			check_memory(2);
 			break;
 		case MEM_SB:
 			byte = value;
 			write_byte_in_memory();
-			check_memory();
+			check_memory(1);
 			break;
 		case MEM_SD:
 			dword = reg[value];
 			write_dword_in_memory();
-			check_memory();
+			check_memory(8);
 			break;
 		case MEM_SWC1:
 			word = *((long*)reg_cop1_simple[value]);
 			write_word_in_memory();
-			check_memory();
+			check_memory(4);
 			break;
 		case MEM_SDC1:
 			dword = *((unsigned long long*)reg_cop1_double[value]);
 			write_dword_in_memory();
-			check_memory();
+			check_memory(8);
 			break;
 		default:
 			stop = 1;
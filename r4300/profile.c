@@ -30,6 +30,7 @@
 #include "r4300.h"
 #include "sys/time.h"
 #include "../gui/DEBUG.h"
+#include "Invalid_Code.h"
 
 #ifdef PROFILE
 
@@ -79,6 +80,13 @@ void refresh_stat()
 	sprintf(txtbuffer, "tramp=%f%%", 100.0f * (float)time_in_section[TRAMP_SECTION] / (float)time_in_section[0]);
 	DEBUG_print(txtbuffer, DBG_PROFILE_TRAMP);
 	
+	unsigned int page, hot_page = 0;
+	for(page=1; page<(CODE_RDRAM_SIZE>>12); ++page)
+	  if(invalid_code_get_count(page) > invalid_code_get_count(hot_page))
+	    hot_page = page;
+	sprintf(txtbuffer, "smc hot page=%08x (%u)", 0x80000000|(hot_page<<12), invalid_code_get_count(hot_page));
+	DEBUG_print(txtbuffer, DBG_PROFILE_SMC);
+	
 	int i;
 	for(i=1; i<=NUM_SECTIONS; ++i) time_in_section[i] = 0;
 	last_start[0] = this_tick;
@@ -51,19 +51,13 @@ extern void update_debugger();
 #include "Invalid_Code.h"
 #include "ARAM-blocks.h"
 
-static void invalidate_func(unsigned int addr){
-  PowerPC_block* block = blocks_get(address>>12);
-	PowerPC_func* func = find_func(&block->funcs, addr);
-	if(func)
-		RecompCache_Free(func->start_addr);
-}
-
-#define check_memory() \
-	if(dynacore && !invalid_code_get(address>>12)/* && \
-	   blocks[address>>12]->code_addr[(address&0xfff)>>2]*/) \
-		invalidate_func(address); //invalid_code_set(address>>12, 1);
+// address is physical (kseg0/1) after the write handler runs,
+//   so only stores which land on recompiled code do any real work
+#define check_memory(length) \
+	if(dynacore && address >= 0x80000000 && address < 0xc0000000) \
+		invalid_code_check_write(address & 0x1FFFFFFF, length);
 #else
-#define check_memory()
+#define check_memory(length)
 #endif
 
 unsigned long interp_addr;
@@ -2904,7 +2898,7 @@ static void SB()
    address = iimmediate + irs32;
    byte = (unsigned char)(irt & 0xFF);
    write_byte_in_memory();
-   check_memory();
+   check_memory(1);
 }
 
 static void SH()
@@ -2913,7 +2907,7 @@ static void SH()
    address = iimmediate + irs32;
    hword = (unsigned short)(irt & 0xFFFF);
    write_hword_in_memory();
-   check_memory();
+   check_memory(2);
 }
 static void SWL()
 {
@@ -2925,7 +2919,7 @@ static void SWL()
 	address = (iimmediate + irs32) & 0xFFFFFFFC;
 	word = (unsigned long)irt;
 	write_word_in_memory();
-	check_memory();
+	check_memory(4);
 	break;
       case 1:
 	address = (iimmediate + irs32) & 0xFFFFFFFC;
@@ -2933,7 +2927,7 @@ static void SWL()
 	read_word_in_memory();
 	word = ((unsigned long)irt >> 8) | (old_word & 0xFF000000);
 	write_word_in_memory();
-	check_memory();
+	check_memory(4);
 	break;
       case 2:
 	address = (iimmediate + irs32) & 0xFFFFFFFC;
@@ -2941,13 +2935,13 @@ static void SWL()
 	read_word_in_memory();
 	word = ((unsigned long)irt >> 16) | (old_word & 0xFFFF0000);
 	write_word_in_memory();
-	check_memory();
+	check_memory(4);
 	break;
       case 3:
 	address = iimmediate + irs32;
 	byte = (unsigned char)(irt >> 24);
 	write_byte_in_memory();
-	check_memory();
+	check_memory(1);
 	break;
      }
 }
@@ -2958,7 +2952,7 @@ static void SW()
    address = iimmediate + irs32;
    word = (unsigned long)(irt & 0xFFFFFFFF);
    write_word_in_memory();
-   check_memory();
+   check_memory(4);
 }
 
 static void SDL()
@@ -2971,7 +2965,7 @@ static void SDL()
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
 	dword = irt;
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 1:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -2979,7 +2973,7 @@ static void SDL()
 	read_dword_in_memory();
 	dword = ((unsigned long long)irt >> 8)|(old_word & 0xFF00000000000000LL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 2:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -2987,7 +2981,7 @@ static void SDL()
 	read_dword_in_memory();
 	dword = ((unsigned long long)irt >> 16)|(old_word & 0xFFFF000000000000LL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 3:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -2995,7 +2989,7 @@ static void SDL()
 	read_dword_in_memory();
 	dword = ((unsigned long long)irt >> 24)|(old_word & 0xFFFFFF0000000000LL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 4:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3003,7 +2997,7 @@ static void SDL()
 	read_dword_in_memory();
 	dword = ((unsigned long long)irt >> 32)|(old_word & 0xFFFFFFFF00000000LL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 5:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3011,7 +3005,7 @@ static void SDL()
 	read_dword_in_memory();
 	dword = ((unsigned long long)irt >> 40)|(old_word & 0xFFFFFFFFFF000000LL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 6:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3019,7 +3013,7 @@ static void SDL()
 	read_dword_in_memory();
 	dword = ((unsigned long long)irt >> 48)|(old_word & 0xFFFFFFFFFFFF0000LL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 7:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3027,7 +3021,7 @@ static void SDL()
 	read_dword_in_memory();
 	dword = ((unsigned long long)irt >> 56)|(old_word & 0xFFFFFFFFFFFFFF00LL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
      }
 }
@@ -3044,7 +3038,7 @@ static void SDR()
 	read_dword_in_memory();
 	dword = (irt << 56) | (old_word & 0x00FFFFFFFFFFFFFFLL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 1:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3052,7 +3046,7 @@ static void SDR()
 	read_dword_in_memory();
 	dword = (irt << 48) | (old_word & 0x0000FFFFFFFFFFFFLL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 2:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3060,7 +3054,7 @@ static void SDR()
 	read_dword_in_memory();
 	dword = (irt << 40) | (old_word & 0x000000FFFFFFFFFFLL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 3:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3068,7 +3062,7 @@ static void SDR()
 	read_dword_in_memory();
 	dword = (irt << 32) | (old_word & 0x00000000FFFFFFFFLL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 4:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3076,7 +3070,7 @@ static void SDR()
 	read_dword_in_memory();
 	dword = (irt << 24) | (old_word & 0x0000000000FFFFFFLL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 5:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3084,7 +3078,7 @@ static void SDR()
 	read_dword_in_memory();
 	dword = (irt << 16) | (old_word & 0x000000000000FFFFLL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 6:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
@@ -3092,13 +3086,13 @@ static void SDR()
 	read_dword_in_memory();
 	dword = (irt << 8) | (old_word & 0x00000000000000FFLL);
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
       case 7:
 	address = (iimmediate + irs32) & 0xFFFFFFF8;
 	dword = irt;
 	write_dword_in_memory();
-	check_memory();
+	check_memory(8);
 	break;
      }
 }
@@ -3115,7 +3109,7 @@ static void SWR()
 	read_word_in_memory();
 	word = ((unsigned long)irt << 24) | (old_word & 0x00FFFFFF);
 	write_word_in_memory();
-	check_memory();
+	check_memory(4);
 	break;
       case 1:
 	address = (iimmediate + irs32) & 0xFFFFFFFC;
@@ -3123,7 +3117,7 @@ static void SWR()
 	read_word_in_memory();
 	word = ((unsigned long)irt << 16) | (old_word & 0x0000FFFF);
 	write_word_in_memory();
-	check_memory();
+	check_memory(4);
 	break;
       case 2:
 	address = (iimmediate + irs32) & 0xFFFFFFFC;
@@ -3131,13 +3125,13 @@ static void SWR()
 	read_word_in_memory();
 	word = ((unsigned long)irt << 8) | (old_word & 0x000000FF);
 	write_word_in_memory();
-	check_memory();
+	check_memory(4);
 	break;
       case 3:
 	address = (iimmediate + irs32) & 0xFFFFFFFC;
 	word = (unsigned long)irt;
 	write_word_in_memory();
-	check_memory();
+	check_memory(4);
 	break;
      }
 }
@@ -3193,7 +3187,7 @@ static void SC()
 	address = iimmediate + irs32;
 	word = (unsigned long)(irt & 0xFFFFFFFF);
 	write_word_in_memory();
-	check_memory();
+	check_memory(4);
 	llbit = 0;
 	irt = 1;
      }
@@ -3210,7 +3204,7 @@ static void SWC1()
    address = lfoffset+reg[lfbase];
    word = *((long*)reg_cop1_simple[lfft]);
    write_word_in_memory();
-   check_memory();
+   check_memory(4);
 }
 
 static void SDC1()
@@ -3220,7 +3214,7 @@ static void SDC1()
    address = lfoffset+reg[lfbase];
    dword = *((unsigned long long*)reg_cop1_double[lfft]);
    write_dword_in_memory();
-   check_memory();
+   check_memory(8);
 }
 
 static void SD()
@@ -3229,7 +3223,7 @@ static void SD()
    address = iimmediate + irs32;
    dword = irt;
    write_dword_in_memory();
-   check_memory();
+   check_memory(8);
 }
 
 /*static*/ void (*interp_ops[64])(void) =
@@ -29,6 +29,8 @@
 
 #include "../config.h"
 #include "../main/ROM-Cache.h"
+#include "../main/rewind.h"
+#include "../main/runahead.h"
 #include "r4300.h"
 #include "ops.h"
 #include "../gc_memory/memory.h"
@@ -1533,6 +1535,7 @@ void init_blocks()
 	invalid_code_set(i, 1);
 	blocks_set(i, NULL);
      }
+   invalid_code_clear_chunks();
 #ifndef PPC_DYNAREC
    blocks[0xa4000000>>12] = malloc(sizeof(precomp_block));
    blocks[0xa4000000>>12]->code = NULL;
@@ -1894,6 +1897,9 @@ void cpu_init(void){
    	PC = malloc(sizeof(precomp_instr));
    // Hack for the interpreter
    cpu_inited = 1;
+   // Snapshots from before a reset can't be rewound to
+   rewind_init();
+   runahead_init();
 }
 
 void cpu_deinit(void){
@@ -38,9 +38,18 @@
 #include "../gc_memory/TLB-Cache.h"
 #include "ARAM-blocks.h"
 
-#include <zlib.h>
+// Remember which physical page the code in this block was unmapped from
+static inline void tlb_save_page(PowerPC_block* block, unsigned long paddr){
+   block->tlb_paddr = paddr;
+   block->tlb_gen = rdram_page_gen[(paddr&0x7FF000)>>12];
+}
 
-uLong ZEXPORT adler32(uLong adler, const Bytef *buf, uInt len);
+// The code is still good if it was remapped to the same physical page
+//   and nothing has written to that page in the meantime
+static inline int tlb_page_unchanged(PowerPC_block* block, unsigned long paddr){
+   return ((block->tlb_paddr ^ paddr) & 0x7FF000) == 0 &&
+          block->tlb_gen == rdram_page_gen[(paddr&0x7FF000)>>12];
+}
 
 void TLBR()
 {
@@ -88,9 +97,9 @@ void TLBWI()
 		  md5_finish(&state, digest);
 		  for (j=0; j<16; j++) blocks[i]->md5[j] = digest[j];*/
 #ifdef USE_TLB_CACHE
-		  temp_block->adler32 = adler32(0, (const Bytef*)&rdram[(paddr&0x7FF000)/4], 0x1000);
+		  tlb_save_page(temp_block, paddr);
 #else
-		  temp_block->adler32 = adler32(0, (const Bytef*)&rdram[(tlb_LUT_r[i]&0x7FF000)/4], 0x1000);
+		  tlb_save_page(temp_block, tlb_LUT_r[i]);
 #endif		  
 		  invalid_code_set(i, 1);
 	       }
@@ -98,7 +107,7 @@ void TLBWI()
 	       {
 		  /*int j;
 		  for (j=0; j<16; j++) blocks[i]->md5[j] = 0;*/
-		  temp_block->adler32 = 0;
+		  temp_block->tlb_paddr = 0;
 	       }
 #ifdef USE_TLB_CACHE
 		TLBCache_set_r(i, 0);
@@ -141,9 +150,9 @@ void TLBWI()
 		  for (j=0; j<16; j++) blocks[i]->md5[j] = digest[j];*/
 		  
 #ifdef USE_TLB_CACHE
-		  temp_block->adler32 = adler32(0, (const Bytef*)&rdram[(paddr&0x7FF000)/4], 0x1000);
+		  tlb_save_page(temp_block, paddr);
 #else
-		  temp_block->adler32 = adler32(0, (const Bytef*)&rdram[(tlb_LUT_r[i]&0x7FF000)/4], 0x1000);
+		  tlb_save_page(temp_block, tlb_LUT_r[i]);
 #endif		  
 		  invalid_code_set(i, 1);
 	       }
@@ -151,7 +160,7 @@ void TLBWI()
 	       {
 		  /*int j;
 		  for (j=0; j<16; j++) blocks[i]->md5[j] = 0;*/
-		  temp_block->adler32 = 0;
+		  temp_block->tlb_paddr = 0;
 	       }
 #ifdef USE_TLB_CACHE
 		TLBCache_set_r(i, 0);
@@ -233,13 +242,13 @@ void TLBWI()
 		      equal = 0;
 		  if (equal) invalid_code_set(i, 0);
 	      }*/
-	     if(temp_block && temp_block->adler32)
+	     if(temp_block && temp_block->tlb_paddr)
 	       {
 #ifdef USE_TLB_CACHE
 		  unsigned long paddr = TLBCache_get_r(i);
-		  if(temp_block->adler32 == adler32(0,(const Bytef*)&rdram[(paddr&0x7FF000)/4],0x1000))
+		  if(tlb_page_unchanged(temp_block, paddr))
 #else
-		  if(temp_block->adler32 == adler32(0,(const Bytef*)&rdram[(tlb_LUT_r[i]&0x7FF000)/4],0x1000))
+		  if(tlb_page_unchanged(temp_block, tlb_LUT_r[i]))
 #endif
 		    invalid_code_set(i, 0);
 	       }
@@ -296,12 +305,12 @@ void TLBWI()
 		      equal = 0;
 		  if (equal) invalid_code_set(i, 0);
 	       }*/
-	     if(temp_block && temp_block->adler32)
+	     if(temp_block && temp_block->tlb_paddr)
 	       {
 #ifdef USE_TLB_CACHE
-		  if(temp_block->adler32 == adler32(0,(const Bytef*)&rdram[(TLBCache_get_r(i)&0x7FF000)/4],0x1000))
+		  if(tlb_page_unchanged(temp_block, TLBCache_get_r(i)))
 #else
-		  if(temp_block->adler32 == adler32(0,(const Bytef*)&rdram[(tlb_LUT_r[i]&0x7FF000)/4],0x1000))
+		  if(tlb_page_unchanged(temp_block, tlb_LUT_r[i]))
 #endif
 		    invalid_code_set(i, 0);
 	       }
@@ -343,9 +352,9 @@ void TLBWR()
 		  md5_finish(&state, digest);
 		  for (j=0; j<16; j++) blocks[i]->md5[j] = digest[j];*/
 #ifdef USE_TLB_CACHE
-		  temp_block->adler32 = adler32(0, (const Bytef*)&rdram[(paddr&0x7FF000)/4], 0x1000);
+		  tlb_save_page(temp_block, paddr);
 #else
-		  temp_block->adler32 = adler32(0, (const Bytef*)&rdram[(tlb_LUT_r[i]&0x7FF000)/4], 0x1000);
+		  tlb_save_page(temp_block, tlb_LUT_r[i]);
 #endif	  
 		  invalid_code_set(i, 1);
 	       }
@@ -353,7 +362,7 @@ void TLBWR()
 	       {
 		  /*int j;
 		  for (j=0; j<16; j++) blocks[i]->md5[j] = 0;*/
-		  temp_block->adler32 = 0;
+		  temp_block->tlb_paddr = 0;
 	       }
 #ifdef USE_TLB_CACHE
 	TLBCache_set_r(i, 0);
@@ -395,9 +404,9 @@ void TLBWR()
 		  md5_finish(&state, digest);
 		  for (j=0; j<16; j++) blocks[i]->md5[j] = digest[j];*/
 #ifdef USE_TLB_CACHE
-		  temp_block->adler32 = adler32(0, (const Bytef*)&rdram[(paddr&0x7FF000)/4], 0x1000);
+		  tlb_save_page(temp_block, paddr);
 #else	  
-		  temp_block->adler32 = adler32(0, (const Bytef*)&rdram[(tlb_LUT_r[i]&0x7FF000)/4], 0x1000);
+		  tlb_save_page(temp_block, tlb_LUT_r[i]);
 #endif
 		  
 		  invalid_code_set(i, 1);
@@ -406,7 +415,7 @@ void TLBWR()
 	       {
 		  /*int j;
 		  for (j=0; j<16; j++) blocks[i]->md5[j] = 0;*/
-		  temp_block->adler32 = 0;
+		  temp_block->tlb_paddr = 0;
 	       }
 #ifdef USE_TLB_CACHE
 		TLBCache_set_r(i, 0);
@@ -487,12 +496,12 @@ void TLBWR()
 		      equal = 0;
 		  if (equal) invalid_code_set(i, 0);
 	       }*/
-	     if(temp_block && temp_block->adler32)
+	     if(temp_block && temp_block->tlb_paddr)
 	       {
 #ifdef USE_TLB_CACHE
-		  if(temp_block->adler32 == adler32(0,(const Bytef*)&rdram[(TLBCache_get_r(i)&0x7FF000)/4],0x1000))
+		  if(tlb_page_unchanged(temp_block, TLBCache_get_r(i)))
 #else
-		  if(temp_block->adler32 == adler32(0,(const Bytef*)&rdram[(tlb_LUT_r[i]&0x7FF000)/4],0x1000))
+		  if(tlb_page_unchanged(temp_block, tlb_LUT_r[i]))
 #endif
 		     invalid_code_set(i, 0);
 	       }
@@ -549,12 +558,12 @@ void TLBWR()
 		      equal = 0;
 		  if (equal) invalid_code_set(i, 0);
 	      }*/
-	     if(temp_block && temp_block->adler32)
+	     if(temp_block && temp_block->tlb_paddr)
 	       {
 #ifdef USE_TLB_CACHE
-		  if(temp_block->adler32 == adler32(0,(const Bytef*)&rdram[(TLBCache_get_r(i)&0x7FF000)/4],0x1000))
+		  if(tlb_page_unchanged(temp_block, TLBCache_get_r(i)))
 #else
-		  if(temp_block->adler32 == adler32(0,(const Bytef*)&rdram[(tlb_LUT_r[i]&0x7FF000)/4],0x1000))
+		  if(tlb_page_unchanged(temp_block, tlb_LUT_r[i]))
 #endif
 		    invalid_code_set(i, 0);
 	       }
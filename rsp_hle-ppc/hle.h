@@ -32,6 +32,8 @@
 #define HLE_H
 
 #include "Rsp_#1.1.h"
+// Tasks bump the page write generations for everything they store to RDRAM
+#include "../r4300/Invalid_Code.h"
 
 #ifdef _BIG_ENDIAN
 #define S 0
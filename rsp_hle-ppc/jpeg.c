@@ -474,6 +474,7 @@ void jpg_uncompress(OSTask_t *task)
      } while (w-- != 1 && !(*rsp.SP_STATUS_REG & 0x80));
    
    pic -= len1 * jpg_data.w / 2;
+   rdram_page_written(jpg_data.pic, len1 * jpg_data.w);
    free(temp2);
    free(temp1);
 }
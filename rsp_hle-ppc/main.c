@@ -164,6 +164,7 @@ __declspec(dllexport) DWORD DoRspCycles ( DWORD Cycles )
 		  for (j=0; j<0xfc; j++)
 		    for (i=0; i<8; i++)
 		      *(rsp.RDRAM+((0x2fb1f0+j*0xff0+i)^S8))=*(rsp.IMEM+((0x120+j*8+i)^S8));
+		  rdram_page_written(0x2fb1f0, 0xfb*0xff0+8);
 	       }
 	     return Cycles;
 	     break;
@@ -174,6 +175,7 @@ __declspec(dllexport) DWORD DoRspCycles ( DWORD Cycles )
 		  for (j=0; j<0xfc; j++)
 		    for (i=0; i<8; i++)
 		      *(rsp.RDRAM+((0x2fb1f0+j*0xff0+i)^S8))=*(rsp.IMEM+((0x120+j*8+i)^S8));
+		  rdram_page_written(0x2fb1f0, 0xfb*0xff0+8);
 	       }
 	     return Cycles;
 	     break;
@@ -258,4 +260,9 @@ __declspec(dllexport) void InitiateRSP ( RSP_INFO Rsp_Info, DWORD * CycleCount)
 #endif
 }
 
+// Audio tasks always run as soon as they're started here
+void joinAudioTask_RSP(void)
+{
+}
+
 #endif
@@ -199,6 +199,7 @@ static void ADPCM(void)
    // save adpcm state
    for (i=0; i<16; i++)
      ((short*)rsp.RDRAM)[(addr/2) + (i^S)] = d.in[(d.buf_out/2) + (16*(len0)) + i];
+   rdram_page_written(addr, 32);
 }
 
 static void CLEARBUFF(void)
@@ -375,6 +376,7 @@ static void ENVMIXER(void)
    *(int*)(rsp.RDRAM + addr + 20) = d.env_rtadd;
    *(int*)(rsp.RDRAM + addr + 24) = d.env_lttar;
    *(int*)(rsp.RDRAM + addr + 28) = d.env_rttar;
+   rdram_page_written(addr, 32);
    
    d.env_lteff=0;
    d.env_rteff=0;
@@ -491,6 +493,7 @@ static void RESAMPLE(void)
         *(int*)(rsp.RDRAM + addr + 8)=savedstate[2];
         *(int*)(rsp.RDRAM + addr + 12)=savedstate[3];
         *(int*)(rsp.RDRAM + addr + 16)=savedstate[4];
+	rdram_page_written(addr, 20);
      }
 }
 
@@ -502,6 +505,7 @@ static void SAVEBUFF(void)
 	unsigned int i;
 	for (i=0; i<d.buf_len/2; i++)
 	  ((short*)rsp.RDRAM)[(addr) + (i^S)] = d.in[(d.buf_out/2) +i];
+	rdram_page_written(addr*2, d.buf_len);
      }
 }
 
@@ -176,6 +176,7 @@ static void ADPCM(void)
    // save adpcm state
    for (i=0; i<16; i++)
      ((short*)rsp.RDRAM)[(addr/2) + (i^S)] = d.in[(inst2 & 0xFFF)/2 + 16*(len0) + i];
+   rdram_page_written(addr, 32);
 }
 
 static void CLEARBUFF(void)
@@ -353,6 +354,7 @@ static void ENVMIXER(void)
    *(int*)(rsp.RDRAM + addr + 20) = d.env_rtadd;
    *(int*)(rsp.RDRAM + addr + 24) = d.env_lttar;
    *(int*)(rsp.RDRAM + addr + 28) = d.env_rttar;
+   rdram_page_written(addr, 32);
    
    d.env_lteff=0;
    d.env_rteff=0;
@@ -468,6 +470,7 @@ static void RESAMPLE(void)
         *(int*)(rsp.RDRAM + addr + 8)=savedstate[2];
         *(int*)(rsp.RDRAM + addr + 12)=savedstate[3];
         *(int*)(rsp.RDRAM + addr + 16)=savedstate[4];
+	rdram_page_written(addr, 20);
      }
 }
 
@@ -479,6 +482,7 @@ static void SAVEBUFF(void)
    unsigned int i;
    for (i=0; i<buf_len/2; i++)
      ((short*)rsp.RDRAM)[addr + (i^S)] = d.in[(buf_out/2) +i];
+   rdram_page_written(addr*2, buf_len);
 }
 
 static void mp3_func(short *m, short *mem)
@@ -1159,6 +1163,7 @@ static void MP3(void)
 	     cpt++;
 	  } while (cpt < 384/64);
 	for (i=0; i<r3/2; i++) *(unsigned short*)(rsp.RDRAM + r22 + (i^S)*2) = mem[3696/2+i];
+	rdram_page_written(r22, r3);
 	r22 += 384;
 	r21 += 384;
 	r2 = r21;
@@ -1166,6 +1171,7 @@ static void MP3(void)
      } while (r20 > 0);
    
    for (i=0; i<1088/2; i++) *(unsigned short*)(rsp.RDRAM + d.mp3_addr + (i^S)*2) = mem[2208/2+i];
+   rdram_page_written(d.mp3_addr, 1088);
 }
 
 static void MP3DATA(void)
@@ -227,6 +227,7 @@ static void ADPCM(void)
    // save adpcm state
    for (i=0; i<16; i++)
      ((short*)rsp.RDRAM)[(addr/2) + (i^S)] = d.in[d.buf_out/2 + 16*(len0) + i];
+   rdram_page_written(addr, 32);
 }
 
 static void CLEARBUFF(void)
@@ -336,6 +337,7 @@ static void RESAMPLE(void)
         *(int*)(rsp.RDRAM + addr + 8)=savedstate[2];
         *(int*)(rsp.RDRAM + addr + 12)=savedstate[3];
         *(int*)(rsp.RDRAM + addr + 16)=savedstate[4];
+	rdram_page_written(addr, 20);
      }
 }
 
@@ -620,6 +622,7 @@ static void SAVEBUFF(void)
    unsigned int i;
    for (i=0; i<buf_len/2; i++)
      ((short*)rsp.RDRAM)[(addr) + (i^S)] = d.in[buf_out/2 +i];
+   rdram_page_written(addr*2, buf_len);
 }
 
 static void ENVSET2(void)
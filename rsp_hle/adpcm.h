@@ -0,0 +1,114 @@
+/**
+ * Wii64 - adpcm.h
+ *
+ * The VADPCM decoder shared by the ADPCM commands of every audio ABI
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#ifndef ADPCM_H
+#define ADPCM_H
+
+/* A frame is a header byte (scale in the upper nibble, predictor in the
+ * lower) followed by 16 samples of 4 bits, or of 2 bits with ABI2's
+ * Flags & 4.  Each half of 8 samples is predicted from the two samples
+ * before it and the residuals so far:
+ *
+ *   out[i] = (book1[i]*l1 + book2[i]*l2 + 2048*r[i]
+ *             + sum(k<i) book2[i-1-k]*r[k]) >> 11
+ *
+ * which is the 8x10 matrix [book1 book2 T] (T the lower triangular
+ * Toeplitz matrix of book2 with 2048 on the diagonal) times the vector
+ * (l1, l2, r[0..7]).  It's computed a column at a time so each term is
+ * one multiply-add into independent accumulators, and only the 36 non
+ * zero entries of T are touched.
+ */
+
+#define ADPCM_FRAME_SAMPLES 16
+#define ADPCM_FRAME_OUT     (ADPCM_FRAME_SAMPLES * 2) // Bytes decoded per frame
+
+/* Unpacks 8 residuals of 'bits' each from dmem.  Scales below 'range'
+ * shift the sample up by scale, anything else is taken as is (shifted
+ * to the top of 16 bits), just as the RSP's vscale multiply did.
+ *   Returns the number of bytes read
+ */
+static inline int hle_adpcm_residuals(const u8* dmem, u32 in, int* r,
+                                      int bits, int scale, int range){
+	int shift = scale < range ? scale : 16 - bits;
+	int per_byte = 8 / bits, i, j;
+
+	for(i=0; i<8; i+=per_byte, ++in){
+		u32 byte = dmem[in^S8] << 24;
+		for(j=0; j<per_byte; ++j, byte <<= bits)
+			r[i+j] = ((int)byte >> (32 - bits)) * (1 << shift);
+	}
+	return 8 / per_byte;
+}
+
+// Predicts 8 samples into out (in the order of the ^S swizzle),
+//   updating l1 and l2 to the last two
+static inline void hle_adpcm_predict(s16* out, const s16* book1, const s16* book2,
+                                     const int* r, int* l1, int* l2){
+	int a[8], i, k;
+
+	for(i=0; i<8; ++i)
+		a[i] = book1[i] * *l1 + book2[i] * *l2 + r[i] * 2048;
+	for(k=0; k<7; ++k)
+		for(i=k+1; i<8; ++i)
+			a[i] += book2[i-1-k] * r[k];
+
+	for(i=0; i<8; ++i){
+		a[i] >>= 11;
+		if(a[i] > 32767) a[i] = 32767;
+		else if(a[i] < -32768) a[i] = -32768;
+	}
+	for(i=0; i<8; ++i)
+		out[i] = a[i^S];
+	*l1 = a[6];
+	*l2 = a[7];
+}
+
+/* Decodes frames from dmem at in until count bytes of output are done.
+ * out holds the last frame decoded before (the loop or saved state) and
+ * the samples are written after it.  table is the ADPCM codebook,
+ * bits 4 or 2 and range the scale at which samples stop being shifted.
+ *   Returns the last frame decoded, which is saved back to RDRAM
+ */
+static inline s16* hle_adpcm_decode(const u8* dmem, u32 in, s16* out, int count,
+                                    const u16* table, int bits, int range){
+	int l1 = out[14^S];
+	int l2 = out[15^S];
+	int r[8];
+
+	out += ADPCM_FRAME_SAMPLES;
+	while(count > 0){
+		int code = dmem[in^S8];
+		const s16* book1 = (const s16*)&table[(code & 0xf) << 4];
+		const s16* book2 = book1 + 8;
+		int scale = code >> 4;
+		++in;
+
+		in += hle_adpcm_residuals(dmem, in, r, bits, scale, range);
+		hle_adpcm_predict(out, book1, book2, r, &l1, &l2);
+		in += hle_adpcm_residuals(dmem, in, r, bits, scale, range);
+		hle_adpcm_predict(out+8, book1, book2, r, &l1, &l2);
+
+		out += ADPCM_FRAME_SAMPLES;
+		count -= ADPCM_FRAME_OUT;
+	}
+	return out - ADPCM_FRAME_SAMPLES;
+}
+
+#endif
@@ -31,6 +31,10 @@
 #define HLE_H
 
 #include "Rsp_#1.1.h"
+#include "../r4300/Invalid_Code.h"
+#ifdef __PPC__
+#include <ogc/machine/processor.h>
+#endif
 
 #ifdef _BIG_ENDIAN
 #define S 0
@@ -73,6 +77,22 @@ typedef signed long long	s64;
 
 extern RSP_INFO rsp;
 
+/* Everything a task stores to RDRAM has to bump the page write generations
+ * so code the TLB unmapped from there isn't revalidated.  Audio tasks may
+ * be on the worker thread, which mustn't be preempted mid bump.
+ */
+static inline void hle_rdram_written(u32 addr, u32 len)
+{
+#ifdef __PPC__
+	u32 level;
+	_CPU_ISR_Disable(level);
+	rdram_page_written(addr, len);
+	_CPU_ISR_Restore(level);
+#else
+	rdram_page_written(addr, len);
+#endif
+}
+
 typedef struct
 {
    unsigned long type;
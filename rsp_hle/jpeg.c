@@ -55,12 +55,190 @@ static short *pic;
 
 static unsigned long len1, len2;
 
+/* The task works on one macroblock at a time: the (h+4) blocks of 64
+ * coefficients are dequantized and unzigzagged, run through the ucode's
+ * IDCT and then converted to pixels.  Every step is the ucode's own fixed
+ * point arithmetic, truncated to 16 bits wherever its vector registers
+ * were, so the output is exactly what the RSP made.
+ */
+
+static const unsigned char jpg_zigzag[64] =
+{
+    0,  8,  1,  2,  9, 16, 24, 17, 10,  3,  4, 11, 18, 25, 32, 40,
+   33, 26, 19, 12,  5,  6, 13, 20, 27, 34, 41, 48, 56, 49, 42, 35,
+   28, 21, 14,  7, 15, 22, 29, 36, 43, 50, 57, 58, 51, 44, 37, 30,
+   23, 31, 38, 45, 52, 59, 60, 53, 46, 39, 47, 54, 61, 62, 55, 63
+};
+
+// The ucode's constants, read out of its data once per task
+typedef struct
+{
+   long d20, d21, d22, d23, d24, d25; // IDCT odd part, doubled
+   long d30, d31, d32, d33, d34;      // IDCT even part, doubled
+   long d1, d2;                       // IDCT output, doubled
+   long up0, up1;                     // chroma upsampling
+   short bias, max;
+   unsigned short cr_r, cb_g, cr_g, cb_b, scale;
+   long r, g, b;
+   short alpha;
+} jpg_consts;
+
+// Coefficients and IDCT output for a macroblock, kept between tasks
+static short *jpg_scratch;
+static long jpg_scratch_blocks;
+
+/* One 8 point pass of the IDCT over in[0], in[stride] ... in[7*stride].
+ * Leaves the even part in e[] and the odd part in o[], the outputs are
+ * e[r]+o[r] and e[r]-o[r] for r and 7-r.
+ */
+static inline void jpg_idct8(const short *in, int stride, const jpg_consts *c,
+		      short *e, short *o)
+{
+   long x0 = in[0*stride], x1 = in[1*stride], x2 = in[2*stride], x3 = in[3*stride];
+   long x4 = in[4*stride], x5 = in[5*stride], x6 = in[6*stride], x7 = in[7*stride];
+   short m4, m5, m6, m7, m8, m9, m10, m11;
+
+   m8  = (x1*c->d20 + 0x8000 + x7*c->d21) >> 16;
+   m9  = (x5*c->d22 + 0x8000 + x3*c->d23) >> 16;
+   m10 = (x3*c->d22 + 0x8000 + x5*c->d24) >> 16;
+   m11 = (x7*c->d20 + 0x8000 + x1*c->d25) >> 16;
+   m6  = (x0*c->d30 + 0x8000 + x4*c->d31) >> 16;
+
+   m5 = m11 - m10;
+   m4 = m8 - m9;
+   o[3] = m8 + m9;
+   o[0] = m11 + m10;
+   o[2] = ((long)m5*c->d30 + 0x8000 + (long)m4*c->d31) >> 16;
+   o[1] = ((long)m5*c->d30 + 0x8000 + (long)m4*c->d30) >> 16;
+
+   m4 = (x0*c->d30 + 0x8000 + x4*c->d30) >> 16;
+   m5 = (x6*c->d32 + 0x8000 + x2*c->d34) >> 16;
+   m7 = (x2*c->d32 + 0x8000 + x6*c->d33) >> 16;
+
+   e[0] = m4 + m5;
+   e[1] = m6 + m7;
+   e[2] = m6 - m7;
+   e[3] = m4 - m5;
+}
+
+// Dequantizes and unzigzags the blocks of the macroblock at pic
+static void jpg_dequantize(short *coef, long blocks, long scale)
+{
+   int i, k;
+   for (i=0; i<blocks; i++)
+     {
+	const short *qt = q[i < blocks-2 ? 0 : i < blocks-1 ? 1 : 2];
+	for (k=0; k<64; k++)
+	  coef[i*64+jpg_zigzag[k]] =
+	    (short)((unsigned short)(pic[(i*64+k)^S]*qt[k^S])*scale);
+     }
+}
+
+static void jpg_idct(short *out, const short *coef, long blocks, const jpg_consts *consts)
+{
+   const jpg_consts cc = *consts, *c = &cc;
+   short t[64], e[4], o[4];
+   int i, j, r;
+
+   for (i=0; i<blocks; i++, coef+=64, out+=64)
+     {
+	// Down the columns, then along the rows of the result
+	for (j=0; j<8; j++)
+	  {
+	     jpg_idct8(coef+j, 8, c, e, o);
+	     for (r=0; r<4; r++)
+	       {
+		  t[r*8+j]     = e[r] + o[r];
+		  t[(7-r)*8+j] = e[r] - o[r];
+	       }
+	  }
+	for (j=0; j<8; j++)
+	  {
+	     jpg_idct8(t+j*8, 1, c, e, o);
+	     for (r=0; r<4; r++)
+	       {
+		  long accum = (long)e[r]*c->d1 + 0x8000 + (long)o[r]*c->d1;
+		  out[r*8+j]     = (short)(accum>>16);
+		  out[(7-r)*8+j] = (accum + (long)o[r]*c->d2)>>16;
+	       }
+	  }
+     }
+}
+
+// What a chroma pair adds to (or for green, takes from) each channel
+typedef struct
+{
+   short r, g, b;
+} jpg_chroma;
+
+static inline void jpg_chroma_offsets(jpg_chroma *o, short cr, short cb, const jpg_consts *c)
+{
+   o->r = (short)(((long)cr*c->cr_r)>>16) + cr;
+   o->g = (short)(((long)cb*c->cb_g)>>16) + (short)(((long)cr*c->cr_g)>>16);
+   o->b = (short)(((long)cb*c->cb_b)>>16) + cb;
+}
+
+static inline short jpg_pixel(short y, const jpg_chroma *o, const jpg_consts *c)
+{
+   short r = y + o->r;
+   short g = y - o->g;
+   short b = y + o->b;
+
+   r = r >= 0 ? r : 0;
+   g = g >= 0 ? g : 0;
+   b = b >= 0 ? b : 0;
+   r = r < c->max ? r : c->max;
+   g = g < c->max ? g : c->max;
+   b = b < c->max ? b : c->max;
+
+   r = (short)(((long)r*c->scale)>>16);
+   g = (short)(((long)g*c->scale)>>16);
+   b = (short)(((long)b*c->scale)>>16);
+
+   r = (short)((unsigned short)r*c->r);
+   g = (short)((long)g*c->g);
+   b = (short)((long)b*c->b);
+
+   return r | g | b | c->alpha;
+}
+
+/* The 16x16 pixels of the macroblock, two luma blocks across by two
+ * down, with the chroma blocks after them at half resolution.  Each
+ * chroma sample is used for the pixel pairs on two rows of each half.
+ */
+static void jpg_color(const short *blk, const jpg_consts *consts)
+{
+   // A copy the stores to pic can't alias
+   const jpg_consts cc = *consts, *c = &cc;
+   int i, j, k;
+   for (i=0; i<2; i++)
+     for (j=0; j<4; j++)
+       {
+	  const short *y = blk + i*128 + j*16;
+	  const short *chroma = blk + 256 + i*32 + j*8;
+	  long out = i*128 + j*32;
+
+	  for (k=0; k<8; k++)
+	    {
+	       long up = k & 1 ? c->up1 : c->up0;
+	       jpg_chroma c0, c1;
+	       jpg_chroma_offsets(&c0, (short)(up*chroma[64+(k>>1)]), (short)(up*chroma[(k>>1)]), c);
+	       jpg_chroma_offsets(&c1, (short)(up*chroma[68+(k>>1)]), (short)(up*chroma[4+(k>>1)]), c);
+
+	       pic[(out+ 0+k)^S] = jpg_pixel(y[k]    + c->bias, &c0, c);
+	       pic[(out+ 8+k)^S] = jpg_pixel(y[64+k] + c->bias, &c1, c);
+	       pic[(out+16+k)^S] = jpg_pixel(y[8+k]  + c->bias, &c0, c);
+	       pic[(out+24+k)^S] = jpg_pixel(y[72+k] + c->bias, &c1, c);
+	    }
+       }
+}
+
 void jpg_uncompress(OSTask_t *task)
 {
-   int i, w;
-   short *temp1,*temp2;
+   int w;
+   long blocks;
    short* data = (short*)(rsp.RDRAM + task->ucode_data);
-   short m[8*32];
+   jpg_consts c;
 
    if (!task->flags & 1)
      {
@@ -90,383 +268,42 @@ void jpg_uncompress(OSTask_t *task)
      }*/
    pic = (short*)(rsp.RDRAM + jpg_data.pic);
 
-   temp1 = (short*)malloc((jpg_data.h+4)*64*2);
-   temp2 = (short*)malloc((jpg_data.h+4)*64*2);
-   w = jpg_data.w;
-
-   do
+   // The color conversion always reads 6 blocks
+   blocks = jpg_data.h+4;
+   if (jpg_scratch_blocks < blocks || jpg_scratch_blocks < 6)
      {
-	// quantification
-	for (i=0; i<(jpg_data.h+2)*64; i++)
-	  temp1[i] = (short)((unsigned short)(pic[i^S]*q[0][(i&0x3F)^S])*(long)data[0^S]);
-	for (;i<(jpg_data.h+3)*64; i++)
-	  temp1[i] = (short)((unsigned short)(pic[i^S]*q[1][(i&0x3F)^S])*(long)data[0^S]);
-	for (;i<(jpg_data.h+4)*64; i++)
-	  temp1[i] = (short)((unsigned short)(pic[i^S]*q[2][(i&0x3F)^S])*(long)data[0^S]);
-
-	// zigzag
-	for (i=0; i<(jpg_data.h+4); i++)
-	  {
-	     temp2[i*64+0 ] = temp1[i*64+0 ];
-	     temp2[i*64+8 ] = temp1[i*64+1 ];
-	     temp2[i*64+1 ] = temp1[i*64+2 ];
-	     temp2[i*64+2 ] = temp1[i*64+3 ];
-	     temp2[i*64+9 ] = temp1[i*64+4 ];
-	     temp2[i*64+16] = temp1[i*64+5 ];
-	     temp2[i*64+24] = temp1[i*64+6 ];
-	     temp2[i*64+17] = temp1[i*64+7 ];
-	     temp2[i*64+10] = temp1[i*64+8 ];
-	     temp2[i*64+3 ] = temp1[i*64+9 ];
-	     temp2[i*64+4 ] = temp1[i*64+10];
-	     temp2[i*64+11] = temp1[i*64+11];
-	     temp2[i*64+18] = temp1[i*64+12];
-	     temp2[i*64+25] = temp1[i*64+13];
-	     temp2[i*64+32] = temp1[i*64+14];
-	     temp2[i*64+40] = temp1[i*64+15];
-	     temp2[i*64+33] = temp1[i*64+16];
-	     temp2[i*64+26] = temp1[i*64+17];
-	     temp2[i*64+19] = temp1[i*64+18];
-	     temp2[i*64+12] = temp1[i*64+19];
-	     temp2[i*64+5 ] = temp1[i*64+20];
-	     temp2[i*64+6 ] = temp1[i*64+21];
-	     temp2[i*64+13] = temp1[i*64+22];
-	     temp2[i*64+20] = temp1[i*64+23];
-	     temp2[i*64+27] = temp1[i*64+24];
-	     temp2[i*64+34] = temp1[i*64+25];
-	     temp2[i*64+41] = temp1[i*64+26];
-	     temp2[i*64+48] = temp1[i*64+27];
-	     temp2[i*64+56] = temp1[i*64+28];
-	     temp2[i*64+49] = temp1[i*64+29];
-	     temp2[i*64+42] = temp1[i*64+30];
-	     temp2[i*64+35] = temp1[i*64+31];
-	     temp2[i*64+28] = temp1[i*64+32];
-	     temp2[i*64+21] = temp1[i*64+33];
-	     temp2[i*64+14] = temp1[i*64+34];
-	     temp2[i*64+7 ] = temp1[i*64+35];
-	     temp2[i*64+15] = temp1[i*64+36];
-	     temp2[i*64+22] = temp1[i*64+37];
-	     temp2[i*64+29] = temp1[i*64+38];
-	     temp2[i*64+36] = temp1[i*64+39];
-	     temp2[i*64+43] = temp1[i*64+40];
-	     temp2[i*64+50] = temp1[i*64+41];
-	     temp2[i*64+57] = temp1[i*64+42];
-	     temp2[i*64+58] = temp1[i*64+43];
-	     temp2[i*64+51] = temp1[i*64+44];
-	     temp2[i*64+44] = temp1[i*64+45];
-	     temp2[i*64+37] = temp1[i*64+46];
-	     temp2[i*64+30] = temp1[i*64+47];
-	     temp2[i*64+23] = temp1[i*64+48];
-	     temp2[i*64+31] = temp1[i*64+49];
-	     temp2[i*64+38] = temp1[i*64+50];
-	     temp2[i*64+45] = temp1[i*64+51];
-	     temp2[i*64+52] = temp1[i*64+52];
-	     temp2[i*64+59] = temp1[i*64+53];
-	     temp2[i*64+60] = temp1[i*64+54];
-	     temp2[i*64+53] = temp1[i*64+55];
-	     temp2[i*64+46] = temp1[i*64+56];
-	     temp2[i*64+39] = temp1[i*64+57];
-	     temp2[i*64+47] = temp1[i*64+58];
-	     temp2[i*64+54] = temp1[i*64+59];
-	     temp2[i*64+61] = temp1[i*64+60];
-	     temp2[i*64+62] = temp1[i*64+61];
-	     temp2[i*64+55] = temp1[i*64+62];
-	     temp2[i*64+63] = temp1[i*64+63];
-	  }
+	long n = blocks > 6 ? blocks : 6;
+	short *s = (short*)realloc(jpg_scratch, n*2*64*2);
+	if (!s) return;
+	jpg_scratch = s;
+	jpg_scratch_blocks = n;
+     }
 
-	// idct
-	for (i=0; i<(jpg_data.h+4); i++)
-	  {
-	     int j,k;
-	     long accum;
+   c.d20 = data[(2*8+0)^S]*2; c.d21 = data[(2*8+1)^S]*2;
+   c.d22 = data[(2*8+2)^S]*2; c.d23 = data[(2*8+3)^S]*2;
+   c.d24 = data[(2*8+4)^S]*2; c.d25 = data[(2*8+5)^S]*2;
+   c.d30 = data[(3*8+0)^S]*2; c.d31 = data[(3*8+1)^S]*2;
+   c.d32 = data[(3*8+2)^S]*2; c.d33 = data[(3*8+3)^S]*2;
+   c.d34 = data[(3*8+4)^S]*2;
+   c.d1  = data[1^S]*2;       c.d2  = data[2^S]*2;
+   c.up0 = data[6^S];         c.up1 = data[7^S];
+   c.cr_r  = data[(1*8+0)^S]; c.cb_g = data[(1*8+1)^S];
+   c.cr_g  = data[(1*8+2)^S]; c.cb_b = data[(1*8+3)^S];
+   c.max   = data[(1*8+4)^S]; c.scale = data[(1*8+6)^S];
+   c.bias  = data[(1*8+7)^S];
+   c.r = data[3^S]; c.g = data[4^S]; c.b = data[5^S];
+   c.alpha = data[6^S];
 
-	     for (j=0; j<8; j++)
-	       {
-		  m[8 *8+j] = (((long)temp2[i*64+1*8+j] * (long)data[(2*8+0)^S]*2)+0x8000
-			       +((long)temp2[i*64+7*8+j] * (long)data[(2*8+1)^S]*2))>>16;
-		  m[9 *8+j] = (((long)temp2[i*64+5*8+j] * (long)data[(2*8+2)^S]*2)+0x8000
-			       +((long)temp2[i*64+3*8+j] * (long)data[(2*8+3)^S]*2))>>16;
-		  m[10*8+j] = (((long)temp2[i*64+3*8+j] * (long)data[(2*8+2)^S]*2)+0x8000
-			       +((long)temp2[i*64+5*8+j] * (long)data[(2*8+4)^S]*2))>>16;
-		  m[11*8+j] = (((long)temp2[i*64+7*8+j] * (long)data[(2*8+0)^S]*2)+0x8000
-			       +((long)temp2[i*64+1*8+j] * (long)data[(2*8+5)^S]*2))>>16;
-
-		  m[6 *8+j] = (((long)temp2[i*64+0*8+j] * (long)data[(3*8+0)^S]*2)+0x8000
-			       +  ((long)temp2[i*64+4*8+j] * (long)data[(3*8+1)^S]*2))>>16;
-
-		  m[5 *8+j] = m[11*8+j]-m[10*8+j];
-		  m[4 *8+j] = m[8 *8+j]-m[9 *8+j];
-		  m[12*8+j] = m[8 *8+j]+m[9 *8+j];
-		  m[15*8+j] = m[11*8+j]+m[10*8+j];
-
-		  m[13*8+j] = (((long)m[5*8+j] * (long)data[(3*8+0)^S]*2)+0x8000
-			       +((long)m[4*8+j] * (long)data[(3*8+1)^S]*2))>>16;
-		  m[14*8+j] = (((long)m[5*8+j] * (long)data[(3*8+0)^S]*2)+0x8000
-			       +((long)m[4*8+j] * (long)data[(3*8+0)^S]*2))>>16;
-
-		  m[4 *8+j] = (((long)temp2[i*64+0*8+j] * (long)data[(3*8+0)^S]*2)+0x8000
-			       +((long)temp2[i*64+4*8+j] * (long)data[(3*8+0)^S]*2))>>16;
-		  m[5 *8+j] = (((long)temp2[i*64+6*8+j] * (long)data[(3*8+2)^S]*2)+0x8000
-			       +((long)temp2[i*64+2*8+j] * (long)data[(3*8+4)^S]*2))>>16;
-		  m[7 *8+j] = (((long)temp2[i*64+2*8+j] * (long)data[(3*8+2)^S]*2)+0x8000
-			       +((long)temp2[i*64+6*8+j] * (long)data[(3*8+3)^S]*2))>>16;
-
-		  m[8 *8+j] = m[4 *8+j]+m[5 *8+j];
-		  m[9 *8+j] = m[6 *8+j]+m[7 *8+j];
-		  m[10*8+j] = m[6 *8+j]-m[7 *8+j];
-		  m[11*8+j] = m[4 *8+j]-m[5 *8+j];
-
-		  m[16*8+j] = m[8 *8+j]+m[15*8+j];
-		  m[17*8+j] = m[9 *8+j]+m[14*8+j];
-		  m[18*8+j] = m[10*8+j]+m[13*8+j];
-		  m[19*8+j] = m[11*8+j]+m[12*8+j];
-		  m[20*8+j] = m[11*8+j]-m[12*8+j];
-		  m[21*8+j] = m[10*8+j]-m[13*8+j];
-		  m[22*8+j] = m[9 *8+j]-m[14*8+j];
-		  m[23*8+j] = m[8 *8+j]-m[15*8+j];
-	       }
-	     // transpose
-	     for (j=0; j<8; j++)
-	       for (k=j; k<8; k++)
-		 {
-		    m[24*8+j*8+k] = m[16*8+k*8+j];
-		    m[24*8+k*8+j] = m[16*8+j*8+k];
-		 }
-
-	     for (j=0; j<8; j++)
-	       {
-		  m[8 *8+j] = (((long)m[25*8+j] * (long)data[(2*8+0)^S]*2)+0x8000
-			       +((long)m[31*8+j] * (long)data[(2*8+1)^S]*2))>>16;
-		  m[9 *8+j] = (((long)m[29*8+j] * (long)data[(2*8+2)^S]*2)+0x8000
-			       +((long)m[27*8+j] * (long)data[(2*8+3)^S]*2))>>16;
-		  m[10*8+j] = (((long)m[27*8+j] * (long)data[(2*8+2)^S]*2)+0x8000
-			       +((long)m[29*8+j] * (long)data[(2*8+4)^S]*2))>>16;
-		  m[11*8+j] = (((long)m[31*8+j] * (long)data[(2*8+0)^S]*2)+0x8000
-			       +((long)m[25*8+j] * (long)data[(2*8+5)^S]*2))>>16;
-
-		  m[6 *8+j] = (((long)m[24*8+j] * (long)data[(3*8+0)^S]*2)+0x8000
-			       +((long)m[28*8+j] * (long)data[(3*8+1)^S]*2))>>16;
-
-		  m[5 *8+j] = m[11*8+j]-m[10*8+j];
-		  m[4 *8+j] = m[8 *8+j]-m[9 *8+j];
-		  m[12*8+j] = m[8 *8+j]+m[9 *8+j];
-		  m[15*8+j] = m[11*8+j]+m[10*8+j];
-
-		  m[13*8+j] = (((long)m[5*8+j] * (long)data[(3*8+0)^S]*2)+0x8000
-			       +((long)m[4*8+j] * (long)data[(3*8+1)^S]*2))>>16;
-		  m[14*8+j] = (((long)m[5*8+j] * (long)data[(3*8+0)^S]*2)+0x8000
-			       +((long)m[4*8+j] * (long)data[(3*8+0)^S]*2))>>16;
-
-		  m[4 *8+j] = (((long)m[24*8+j] * (long)data[(3*8+0)^S]*2)+0x8000
-			       +((long)m[28*8+j] * (long)data[(3*8+0)^S]*2))>>16;
-		  m[5 *8+j] = (((long)m[30*8+j] * (long)data[(3*8+2)^S]*2)+0x8000
-			       +((long)m[26*8+j] * (long)data[(3*8+4)^S]*2))>>16;
-		  m[7 *8+j] = (((long)m[26*8+j] * (long)data[(3*8+2)^S]*2)+0x8000
-			       +((long)m[30*8+j] * (long)data[(3*8+3)^S]*2))>>16;
-
-		  m[8 *8+j] = m[4 *8+j]+m[5 *8+j];
-		  m[9 *8+j] = m[6 *8+j]+m[7 *8+j];
-		  m[10*8+j] = m[6 *8+j]-m[7 *8+j];
-		  m[11*8+j] = m[4 *8+j]-m[5 *8+j];
-
-		  accum = ((long)m[8 *8+j] * (long)data[1^S]*2)+0x8000
-		    + ((long)m[15*8+j] * (long)data[1^S]*2);
-		  temp1[i*64+0*8+j] = (short)(accum>>16);
-		  temp1[i*64+7*8+j] = (accum+((long)m[15*8+j]*(long)data[2^S]*2))>>16;
-		  accum = ((long)m[9 *8+j] * (long)data[1^S]*2)+0x8000
-		    + ((long)m[14*8+j] * (long)data[1^S]*2);
-		  temp1[i*64+1*8+j] = (short)(accum>>16);
-		  temp1[i*64+6*8+j] = (accum+((long)m[14*8+j]*(long)data[2^S]*2))>>16;
-		  accum = ((long)m[10*8+j] * (long)data[1^S]*2)+0x8000
-		    + ((long)m[13*8+j] * (long)data[1^S]*2);
-		  temp1[i*64+2*8+j] = (short)(accum>>16);
-		  temp1[i*64+5*8+j] = (accum+((long)m[13*8+j]*(long)data[2^S]*2))>>16;
-		  accum = ((long)m[11*8+j] * (long)data[1^S]*2)+0x8000
-		    + ((long)m[12*8+j] * (long)data[1^S]*2);
-		  temp1[i*64+3*8+j] = (short)(accum>>16);
-		  temp1[i*64+4*8+j] = (accum+((long)m[12*8+j]*(long)data[2^S]*2))>>16;
-	       }
-	  }
-
-	/*if (jpg_data.h == 0)
-	  {
-#ifdef __WIN32
-	     MessageBox(NULL, "h==0", "h==0", MB_OK);
-#else
-	     printf("h==0\n");
-#endif
-	  }
-	else*/
-	  {
-	     for (i=0; i<8; i++)
-	       m[9 *8+i] = m[10*8+i] = m[11*8+i] = m[12*8+i] = 0;
-	     m[9 *8+0] = m[10*8+2] = m[11*8+4] = m[12*8+6] = data[6^S];
-	     m[9 *8+1] = m[10*8+3] = m[11*8+5] = m[12*8+7] = data[7^S];
-	     for (i=0; i<8; i++)
-	       {
-		  m[1 *8+i] = data[(0*8+i)^S];
-		  m[4 *8+i] = data[(1*8+i)^S];
-	       }
-	     for (i=0; i<2; i++)
-	       {
-		  int j;
-		  for (j=0; j<4; j++)
-		    {
-		       int k;
-		       for (k=0; k<8; k++)
-			 {
-			    m[16*8+k]=(short)((long)m[9 *8+k]*(long)temp1[256+i*32+j*8+64+0]
-					      +(long)m[10*8+k]*(long)temp1[256+i*32+j*8+64+1]
-					      +(long)m[11*8+k]*(long)temp1[256+i*32+j*8+64+2]
-					      +(long)m[12*8+k]*(long)temp1[256+i*32+j*8+64+3]);
-
-			    m[15*8+k] =(short)((long)m[9 *8+k]*(long)temp1[256+i*32+j*8+64+4]
-					       +(long)m[10*8+k]*(long)temp1[256+i*32+j*8+64+5]
-					       +(long)m[11*8+k]*(long)temp1[256+i*32+j*8+64+6]
-					       +(long)m[12*8+k]*(long)temp1[256+i*32+j*8+64+7]);
-
-			    m[18*8+k] = temp1[i*128+j*16+k]+m[4*8+7];
-			    m[17*8+k] = temp1[i*128+j*16+64+k]+m[4*8+7];
-
-			    m[14*8+k] =(short)((long)m[9 *8+k]*(long)temp1[256+i*32+j*8+0]
-					       +(long)m[10*8+k]*(long)temp1[256+i*32+j*8+1]
-					       +(long)m[11*8+k]*(long)temp1[256+i*32+j*8+2]
-					       +(long)m[12*8+k]*(long)temp1[256+i*32+j*8+3]);
-
-			    m[13*8+k] =(short)((long)m[9 *8+k]*(long)temp1[256+i*32+j*8+4]
-					       +(long)m[10*8+k]*(long)temp1[256+i*32+j*8+5]
-					       +(long)m[11*8+k]*(long)temp1[256+i*32+j*8+6]
-					       +(long)m[12*8+k]*(long)temp1[256+i*32+j*8+7]);
-
-			    m[24*8+k] = (short)(((long)m[16*8+k]*(unsigned short)m[4*8+0])>>16);
-			    m[23*8+k] = (short)(((long)m[15*8+k]*(unsigned short)m[4*8+0])>>16);
-			    m[26*8+k] = (short)(((long)m[14*8+k]*(unsigned short)m[4*8+1])>>16);
-			    m[25*8+k] = (short)(((long)m[13*8+k]*(unsigned short)m[4*8+1])>>16);
-			    m[21*8+k] = (short)(((long)m[16*8+k]*(unsigned short)m[4*8+2])>>16);
-			    m[22*8+k] = (short)(((long)m[15*8+k]*(unsigned short)m[4*8+2])>>16);
-			    m[28*8+k] = (short)(((long)m[14*8+k]*(unsigned short)m[4*8+3])>>16);
-			    m[27*8+k] = (short)(((long)m[13*8+k]*(unsigned short)m[4*8+3])>>16);
-
-			    m[24*8+k] += m[16*8+k];
-			    m[23*8+k] += m[15*8+k];
-			    m[26*8+k] += m[21*8+k];
-			    m[25*8+k] += m[22*8+k];
-			    m[28*8+k] += m[14*8+k];
-			    m[27*8+k] += m[13*8+k];
-			    m[24*8+k] += m[18*8+k];
-			    m[23*8+k] += m[17*8+k];
-			    m[26*8+k] = m[18*8+k] - m[26*8+k];
-			    m[25*8+k] = m[17*8+k] - m[25*8+k];
-			    m[28*8+k] += m[18*8+k];
-			    m[27*8+k] += m[17*8+k];
-
-			    m[23*8+k] = m[23*8+k] >= 0 ? m[23*8+k] : 0;
-			    m[24*8+k] = m[24*8+k] >= 0 ? m[24*8+k] : 0;
-			    m[25*8+k] = m[25*8+k] >= 0 ? m[25*8+k] : 0;
-			    m[26*8+k] = m[26*8+k] >= 0 ? m[26*8+k] : 0;
-			    m[27*8+k] = m[27*8+k] >= 0 ? m[27*8+k] : 0;
-			    m[28*8+k] = m[28*8+k] >= 0 ? m[28*8+k] : 0;
-
-			    m[23*8+k] = m[23*8+k] < m[4*8+4] ? m[23*8+k] : m[4*8+4];
-			    m[24*8+k] = m[24*8+k] < m[4*8+4] ? m[24*8+k] : m[4*8+4];
-			    m[25*8+k] = m[25*8+k] < m[4*8+4] ? m[25*8+k] : m[4*8+4];
-			    m[26*8+k] = m[26*8+k] < m[4*8+4] ? m[26*8+k] : m[4*8+4];
-			    m[27*8+k] = m[27*8+k] < m[4*8+4] ? m[27*8+k] : m[4*8+4];
-			    m[28*8+k] = m[28*8+k] < m[4*8+4] ? m[28*8+k] : m[4*8+4];
-
-			    m[23*8+k] = (short)(((long)m[23*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[24*8+k] = (short)(((long)m[24*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[25*8+k] = (short)(((long)m[25*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[26*8+k] = (short)(((long)m[26*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[27*8+k] = (short)(((long)m[27*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[28*8+k] = (short)(((long)m[28*8+k] * (unsigned short)m[4*8+6])>>16);
-
-			    m[23*8+k] = (short)((unsigned short)m[23*8+k] * (long)m[1*8+3]);
-			    m[24*8+k] = (short)((unsigned short)m[24*8+k] * (long)m[1*8+3]);
-			    m[25*8+k] = (short)((long)m[25*8+k] * (long)m[1*8+4]);
-			    m[26*8+k] = (short)((long)m[26*8+k] * (long)m[1*8+4]);
-			    m[27*8+k] = (short)((long)m[27*8+k] * (long)m[1*8+5]);
-			    m[28*8+k] = (short)((long)m[28*8+k] * (long)m[1*8+5]);
-
-			    m[18*8+k] = temp1[i*128+j*16+8+k] + m[4*8+7];
-			    m[17*8+k] = temp1[i*128+j*16+8+64+k] + m[4*8+7];
-
-			    m[24*8+k] |= m[26*8+k];
-			    m[23*8+k] |= m[25*8+k];
-
-			    m[20*8+k] = (short)(((long)m[16*8+k] * (unsigned short)m[4*8+0])>>16);
-			    m[19*8+k] = (short)(((long)m[15*8+k] * (unsigned short)m[4*8+0])>>16);
-
-			    m[30*8+k] = m[24*8+k] | m[28*8+k];
-			    m[29*8+k] = m[23*8+k] | m[27*8+k];
-
-			    m[26*8+k] = (short)(((long)m[14*8+k] * (unsigned short)m[4*8+1])>>16);
-			    m[25*8+k] = (short)(((long)m[13*8+k] * (unsigned short)m[4*8+1])>>16);
-			    m[21*8+k] = (short)(((long)m[16*8+k] * (unsigned short)m[4*8+2])>>16);
-			    m[22*8+k] = (short)(((long)m[15*8+k] * (unsigned short)m[4*8+2])>>16);
-			    m[28*8+k] = (short)(((long)m[14*8+k] * (unsigned short)m[4*8+3])>>16);
-			    m[27*8+k] = (short)(((long)m[13*8+k] * (unsigned short)m[4*8+3])>>16);
-
-			    m[30*8+k] |= m[1*8+6];
-			    m[29*8+k] |= m[1*8+6];
-
-			    pic[(i*128+j*32+0+k)^S] = m[30*8+k];
-			    pic[(i*128+j*32+8+k)^S] = m[29*8+k];
-
-			    m[24*8+k] = m[20*8+k] + m[16*8+k];
-			    m[23*8+k] = m[19*8+k] + m[15*8+k];
-
-			    m[26*8+k] += m[21*8+k];
-			    m[25*8+k] += m[22*8+k];
-			    m[28*8+k] += m[14*8+k];
-			    m[27*8+k] += m[13*8+k];
-			    m[24*8+k] += m[18*8+k];
-			    m[23*8+k] += m[17*8+k];
-
-			    m[26*8+k] = m[18*8+k] - m[26*8+k];
-			    m[25*8+k] = m[17*8+k] - m[25*8+k];
-
-			    m[28*8+k] += m[18*8+k];
-			    m[27*8+k] += m[17*8+k];
-
-			    m[23*8+k] = m[23*8+k] >= 0 ? m[23*8+k] : 0;
-			    m[24*8+k] = m[24*8+k] >= 0 ? m[24*8+k] : 0;
-			    m[25*8+k] = m[25*8+k] >= 0 ? m[25*8+k] : 0;
-			    m[26*8+k] = m[26*8+k] >= 0 ? m[26*8+k] : 0;
-			    m[27*8+k] = m[27*8+k] >= 0 ? m[27*8+k] : 0;
-			    m[28*8+k] = m[28*8+k] >= 0 ? m[28*8+k] : 0;
-
-			    m[23*8+k] = m[23*8+k] < m[4*8+4] ? m[23*8+k] : m[4*8+4];
-			    m[24*8+k] = m[24*8+k] < m[4*8+4] ? m[24*8+k] : m[4*8+4];
-			    m[25*8+k] = m[25*8+k] < m[4*8+4] ? m[25*8+k] : m[4*8+4];
-			    m[26*8+k] = m[26*8+k] < m[4*8+4] ? m[26*8+k] : m[4*8+4];
-			    m[27*8+k] = m[27*8+k] < m[4*8+4] ? m[27*8+k] : m[4*8+4];
-			    m[28*8+k] = m[28*8+k] < m[4*8+4] ? m[28*8+k] : m[4*8+4];
-
-			    m[23*8+k] = (short)(((long)m[23*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[24*8+k] = (short)(((long)m[24*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[25*8+k] = (short)(((long)m[25*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[26*8+k] = (short)(((long)m[26*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[27*8+k] = (short)(((long)m[27*8+k] * (unsigned short)m[4*8+6])>>16);
-			    m[28*8+k] = (short)(((long)m[28*8+k] * (unsigned short)m[4*8+6])>>16);
-
-			    m[23*8+k] = (short)((unsigned short)m[23*8+k] * (long)m[1*8+3]);
-			    m[24*8+k] = (short)((unsigned short)m[24*8+k] * (long)m[1*8+3]);
-			    m[25*8+k] = (short)((long)m[25*8+k] * (long)m[1*8+4]);
-			    m[26*8+k] = (short)((long)m[26*8+k] * (long)m[1*8+4]);
-			    m[27*8+k] = (short)((long)m[27*8+k] * (long)m[1*8+5]);
-			    m[28*8+k] = (short)((long)m[28*8+k] * (long)m[1*8+5]);
-
-			    pic[(i*128+j*32+16+k)^S] = m[24*8+k] | m[26*8+k] | m[28*8+k] | m[1*8+6];
-			    pic[(i*128+j*32+24+k)^S] = m[23*8+k] | m[25*8+k] | m[27*8+k] | m[1*8+6];
-			 }
-		    }
-	       }
-	  }
+   w = jpg_data.w;
+   do
+     {
+	short *coef = jpg_scratch, *blk = jpg_scratch + jpg_scratch_blocks*64;
+	jpg_dequantize(coef, blocks, data[0^S]);
+	jpg_idct(blk, coef, blocks, &c);
+	jpg_color(blk, &c);
 	pic += len1/2;
      } while (w-- != 1 && !(*rsp.SP_STATUS_REG & 0x80));
 
    pic -= len1 * jpg_data.w / 2;
-
-   free(temp2);
-   free(temp1);
+   hle_rdram_written(jpg_data.pic, len1 * jpg_data.w);
 }
@@ -109,30 +109,76 @@ extern void (*ABI1[0x20])();
 extern void (*ABI2[0x20])();
 extern void (*ABI3[0x20])();
 
-void (*ABI[0x20])();
+void (**ABI)();
 
 u32 inst1, inst2;
 
-static int audio_ucode(OSTask_t *task)
+/* Audio tasks run from a decoded copy of their alist: the handler of each
+ * command is looked up while decoding, and commands which land on the
+ * ABI's no-op (entry 0 in every table) are dropped there.  The real ucode
+ * DMAs the alist into DMEM ahead of running it too.
+ *
+ * The ABI is only detected again when the ucode or the words detection
+ * looks at change, games keep the same audio ucode loaded for good.
+ */
+typedef struct {
+	void (*fn)();
+	u32 inst1, inst2;
+} acmd_t;
+
+#define ACMD_MAX 0x200 // Decoded at a time
+
+static acmd_t acmds[ACMD_MAX];
+
+static struct {
+	unsigned long ucode, ucode_data;
+	unsigned long data0, data30;
+	void (**abi)();
+} abiCache;
+
+static void (**audio_abi(OSTask_t *task))()
 {
-	unsigned long *p_alist = (unsigned long*)(rsp.RDRAM + task->data_ptr);
-	unsigned int i;
+	unsigned long data0  = *(unsigned long*)(rsp.RDRAM + task->ucode_data + 0);
+	unsigned long data30 = *(unsigned long*)(rsp.RDRAM + task->ucode_data + 0x30);
+
+	if (abiCache.abi && abiCache.ucode == task->ucode &&
+	    abiCache.ucode_data == task->ucode_data &&
+	    abiCache.data0 == data0 && abiCache.data30 == data30)
+		return abiCache.abi;
 
 	switch(audio_ucode_detect(task))
 	{
 	case 1: // mario ucode
-		memcpy( ABI, ABI1, sizeof(ABI[0])*0x20 );
+		abiCache.abi = ABI1;
 //		DEBUG_print("Audio Ucode 1: Mario",DBG_RSPINFO1);
 		break;
 	case 2: // banjo kazooie ucode
-		memcpy( ABI, ABI2, sizeof(ABI[0])*0x20 );
+		abiCache.abi = ABI2;
 //		DEBUG_print("Audio Ucode 2: Banjo",DBG_RSPINFO1);
 		break;
 	case 3: // zelda ucode
-		memcpy( ABI, ABI3, sizeof(ABI[0])*0x20 );
+		abiCache.abi = ABI3;
 //		DEBUG_print("Audio Ucode 3: Zelda",DBG_RSPINFO1);
 		break;
 	default:
+		abiCache.abi = NULL;
+		break;
+	}
+	abiCache.ucode      = task->ucode;
+	abiCache.ucode_data = task->ucode_data;
+	abiCache.data0      = data0;
+	abiCache.data30     = data30;
+	return abiCache.abi;
+}
+
+static int audio_ucode(OSTask_t *task)
+{
+	unsigned long *p_alist = (unsigned long*)(rsp.RDRAM + task->data_ptr);
+	unsigned int i, num_cmds = task->data_size/8;
+
+	ABI = audio_abi(task);
+	if (!ABI)
+	{
 		{
 //		DEBUG_print("Audio Ucode Invalid",DBG_RSPINFO1);
 /*		char s[1024];
@@ -148,20 +194,111 @@ static int audio_ucode(OSTask_t *task)
 
 //	data = (short*)(rsp.RDRAM + task->ucode_data);
 
-	for (i = 0; i < (task->data_size/4); i += 2)
+	for (i = 0; i < num_cmds; )
 	{
-		inst1 = p_alist[i];
-		inst2 = p_alist[i+1];
-		ABI[inst1 >> 24]();
+		unsigned int n = 0, c;
+
+		for (; i < num_cmds && n < ACMD_MAX; i++)
+		{
+			u32 w0 = p_alist[i*2];
+			void (*fn)() = ABI[w0 >> 24];
+			if (fn == ABI[0]) continue;
+			acmds[n].fn    = fn;
+			acmds[n].inst1 = w0;
+			acmds[n].inst2 = p_alist[i*2+1];
+			n++;
+		}
+
+		for (c = 0; c < n; c++)
+		{
+			inst1 = acmds[c].inst1;
+			inst2 = acmds[c].inst2;
+			acmds[c].fn();
+		}
 	}
 
 	return 0;
 }
 
+#ifdef __PPC__
+/* With audioTaskDelay set, audio tasks are handed to a worker below the
+ * emulation thread's priority and their SP interrupt comes that many
+ * thousand Count cycles later.  There's only the one core, so the worker
+ * runs while the emulation thread is blocked (on the audio buffers, a
+ * vsync or the GX fifo), and whatever it hasn't done by the time the
+ * results are needed is run in place by joinAudioTask_RSP.  That happens
+ * before the SP interrupt, the next SP task, an AI DMA and savestates.
+ *
+ * The task writes its output to the RDRAM buffers its alist names, games
+ * already alternate between two of those and don't touch the one being
+ * made until the SP interrupt says so.
+ */
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/semaphore.h>
+#include "../main/wii64config.h"
+
+#define AUDIO_TASK_PRIORITY 50
+
+static OSTask_t audioTask; // Copied, the CPU is free to reuse DMEM
+static volatile int audioTaskPending;
+static lwp_t audioThread = LWP_THREAD_NULL;
+static sem_t audioTaskReady;
+static mutex_t audioTaskLock;
+
+static void run_audio_task(void)
+{
+	LWP_MutexLock(audioTaskLock);
+	if (audioTaskPending)
+	{
+		audio_ucode(&audioTask);
+		audioTaskPending = 0;
+	}
+	LWP_MutexUnlock(audioTaskLock);
+}
+
+static void* audio_thread(void* arg)
+{
+	while (1)
+	{
+		LWP_SemWait(audioTaskReady);
+		run_audio_task();
+	}
+	return NULL;
+}
+
+void joinAudioTask_RSP(void)
+{
+	if (audioTaskPending) run_audio_task();
+}
+
+// Returns 0 if the task has to be run in place
+static int queue_audio_task(OSTask_t *task)
+{
+	if (!audioTaskDelay) return 0;
+	if (audioThread == LWP_THREAD_NULL)
+	{
+		LWP_MutexInit(&audioTaskLock, false);
+		LWP_SemInit(&audioTaskReady, 0, 1);
+		LWP_CreateThread(&audioThread, audio_thread, NULL, NULL, 0, AUDIO_TASK_PRIORITY);
+	}
+	audioTask = *task;
+	audioTaskPending = 1;
+	LWP_SemPost(audioTaskReady);
+	return 1;
+}
+#else
+void joinAudioTask_RSP(void)
+{
+}
+#endif
+
 __declspec(dllexport) DWORD DoRspCycles ( DWORD Cycles )
 {
    OSTask_t *task = (OSTask_t*)(rsp.DMEM + 0xFC0);
    unsigned int i, sum=0;
+
+   joinAudioTask_RSP();
 #ifdef __WIN32__
    if(firstTime)
    {
@@ -228,6 +365,7 @@ __declspec(dllexport) DWORD DoRspCycles ( DWORD Cycles )
 		  for (j=0; j<0xfc; j++)
 		    for (i=0; i<8; i++)
 		      *(rsp.RDRAM+((0x2fb1f0+j*0xff0+i)^S8))=*(rsp.IMEM+((0x120+j*8+i)^S8));
+		  hle_rdram_written(0x2fb1f0, 0xfb*0xff0+8);
 	       }
 	     return Cycles;
 	     break;
@@ -238,6 +376,7 @@ __declspec(dllexport) DWORD DoRspCycles ( DWORD Cycles )
 		  for (j=0; j<0xfc; j++)
 		    for (i=0; i<8; i++)
 		      *(rsp.RDRAM+((0x2fb1f0+j*0xff0+i)^S8))=*(rsp.IMEM+((0x120+j*8+i)^S8));
+		  hle_rdram_written(0x2fb1f0, 0xfb*0xff0+8);
 	       }
 	     return Cycles;
 	     break;
@@ -248,6 +387,10 @@ __declspec(dllexport) DWORD DoRspCycles ( DWORD Cycles )
 	switch(task->type)
 	  {
 	   case 2: // audio
+#ifdef __PPC__
+		 if (queue_audio_task(task))
+		   return Cycles;
+#endif
 		 if (audio_ucode(task) == 0)
 		   return Cycles;
 		 break;
@@ -297,12 +440,14 @@ __declspec(dllexport) void InitiateRSP ( RSP_INFO Rsp_Info, DWORD * CycleCount)
 __declspec(dllexport) void RomClosed (void)
 {
    int i;
+   joinAudioTask_RSP();
    for (i=0; i<0x1000; i++)
      {
 	rsp.DMEM[i] = rsp.IMEM[i] = 0;
      }
    //init_ucode1();
    init_ucode2();
+   abiCache.abi = NULL;
 #ifdef __WIN32__
    firstTime = TRUE;
 #endif
@@ -0,0 +1,138 @@
+/**
+ * Wii64 - mixer.h
+ *
+ * Saturating sample kernels shared by the audio ucodes' mixers
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#ifndef MIXER_H
+#define MIXER_H
+
+/* The RSP mixes 8 samples per vector op, these work 4 at a time: all four
+ * are loaded before any is stored so the loads overlap, and saturating
+ * costs one rarely taken branch.  Every operation is elementwise on the
+ * same index of each buffer, so the ^S swizzle never comes into it.
+ *
+ * Working a group at a time gives the same result as the scalar loops
+ * as long as the buffers involved are a multiple of 4 samples apart
+ * (they are 16 byte aligned in every ucode seen), otherwise these fall
+ * back to a sample at a time.
+ */
+
+#define HLE_MIX_GROUP 4
+
+static inline s32 hle_sat16(s32 v){
+	if((u32)(v + 0x8000) > 0xFFFF) v = (v >> 31) ^ 0x7FFF;
+	return v;
+}
+
+static inline int hle_mix_grouped(const s16* a, const s16* b){
+	return !(((const u8*)a - (const u8*)b) & (HLE_MIX_GROUP*sizeof(s16) - 1));
+}
+
+// out[i] += (in[i] * gain) >> 15 for MIXER
+static inline void hle_mix_gain(s16* out, const s16* in, s32 gain, int count){
+	int i = 0;
+	if(hle_mix_grouped(out, in)){
+		for(; i + HLE_MIX_GROUP <= count; i += HLE_MIX_GROUP){
+			s32 i0 = in[i], i1 = in[i+1], i2 = in[i+2], i3 = in[i+3];
+			s32 o0 = out[i], o1 = out[i+1], o2 = out[i+2], o3 = out[i+3];
+			out[i]   = hle_sat16(o0 + ((i0 * gain) >> 15));
+			out[i+1] = hle_sat16(o1 + ((i1 * gain) >> 15));
+			out[i+2] = hle_sat16(o2 + ((i2 * gain) >> 15));
+			out[i+3] = hle_sat16(o3 + ((i3 * gain) >> 15));
+		}
+	}
+	for(; i < count; ++i)
+		out[i] = hle_sat16(out[i] + ((in[i] * gain) >> 15));
+}
+
+// out[i] += in[i] for ADDMIXER and the envelope mixers' sends
+static inline void hle_mix_add(s16* out, const s16* in, int count){
+	int i = 0;
+	if(hle_mix_grouped(out, in)){
+		for(; i + HLE_MIX_GROUP <= count; i += HLE_MIX_GROUP){
+			s32 i0 = in[i], i1 = in[i+1], i2 = in[i+2], i3 = in[i+3];
+			s32 o0 = out[i], o1 = out[i+1], o2 = out[i+2], o3 = out[i+3];
+			out[i]   = hle_sat16(o0 + i0);
+			out[i+1] = hle_sat16(o1 + i1);
+			out[i+2] = hle_sat16(o2 + i2);
+			out[i+3] = hle_sat16(o3 + i3);
+		}
+	}
+	for(; i < count; ++i)
+		out[i] = hle_sat16(out[i] + in[i]);
+}
+
+// buf[i] = buf[i] * (hi + lo<<16) >> 16 for HILOGAIN
+static inline void hle_hilogain(s16* buf, s32 hi, u32 lo, int count){
+	int i = 0;
+	for(; i + HLE_MIX_GROUP <= count; i += HLE_MIX_GROUP){
+		s32 v0 = buf[i], v1 = buf[i+1], v2 = buf[i+2], v3 = buf[i+3];
+		buf[i]   = hle_sat16(((v0 * hi) >> 16) + (u32)(v0 * lo));
+		buf[i+1] = hle_sat16(((v1 * hi) >> 16) + (u32)(v1 * lo));
+		buf[i+2] = hle_sat16(((v2 * hi) >> 16) + (u32)(v2 * lo));
+		buf[i+3] = hle_sat16(((v3 * hi) >> 16) + (u32)(v3 * lo));
+	}
+	for(; i < count; ++i){
+		s32 v = buf[i];
+		buf[i] = hle_sat16(((v * hi) >> 16) + (u32)(v * lo));
+	}
+}
+
+#define HLE_ENVMIX_ROUND(d, x, v) hle_sat16((d) + (((x) * (v) + 0x4000) >> 15))
+
+/* One 8 sample block of ENVMIXER/ENVMIXER3: dst[k][i] += in[i] * vol[k][i]
+ * rounded, for the first num_dst (2 or 4) buffers.  vol is in the same
+ * (swizzled) order as the samples.  Each sample is read from every buffer
+ * before it's written to any, like the scalar loops, which matters when
+ * the game points two of them at the same buffer.
+ */
+static inline void hle_envmix8(const s16* in, s16* const* dst,
+                               s32 vol[][8], int num_dst){
+	int i = 0, k, grouped = 1;
+	for(k=0; k<num_dst; ++k)
+		grouped &= hle_mix_grouped(dst[k], in);
+
+	if(grouped){
+		for(; i < 8; i += HLE_MIX_GROUP){
+			s32 x0 = in[i], x1 = in[i+1], x2 = in[i+2], x3 = in[i+3];
+			s16 r[4][HLE_MIX_GROUP];
+			for(k=0; k<num_dst; ++k){
+				r[k][0] = HLE_ENVMIX_ROUND(dst[k][i],   x0, vol[k][i]);
+				r[k][1] = HLE_ENVMIX_ROUND(dst[k][i+1], x1, vol[k][i+1]);
+				r[k][2] = HLE_ENVMIX_ROUND(dst[k][i+2], x2, vol[k][i+2]);
+				r[k][3] = HLE_ENVMIX_ROUND(dst[k][i+3], x3, vol[k][i+3]);
+			}
+			for(k=0; k<num_dst; ++k){
+				dst[k][i]   = r[k][0]; dst[k][i+1] = r[k][1];
+				dst[k][i+2] = r[k][2]; dst[k][i+3] = r[k][3];
+			}
+		}
+	}
+	// In the order the scalar loops went, for buffers that half overlap
+	for(; i < 8; ++i){
+		int j = i^S;
+		s32 x = in[j];
+		s16 r[4];
+		for(k=0; k<num_dst; ++k)
+			r[k] = HLE_ENVMIX_ROUND(dst[k][j], x, vol[k][j]);
+		for(k=0; k<num_dst; ++k)
+			dst[k][j] = r[k];
+	}
+}
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * Wii64 - resample.h
+ *
+ * The 4 tap resampler shared by the RESAMPLE commands of every audio ABI
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "mixer.h"
+
+/* Accum is the 16 bit fraction of the source position; its top 6 bits
+ * pick one of the 64 phases of 4 taps in the LUT.  Stepping it is a
+ * serial chain, so each run first works out the source position and the
+ * taps of every output, and then filters the run HLE_MIX_GROUP outputs
+ * at a time with nothing left between them but loads and multiplies.
+ */
+
+#define HLE_RESAMPLE_RUN 16
+
+static inline s32 hle_resample_tap(const s16* src, u32 pos, const s16* lut){
+	s32 accum;
+	accum  = (src[(pos+0)^S] * lut[0]) >> 15;
+	accum += (src[(pos+1)^S] * lut[1]) >> 15;
+	accum += (src[(pos+2)^S] * lut[2]) >> 15;
+	accum += (src[(pos+3)^S] * lut[3]) >> 15;
+	return hle_sat16(accum);
+}
+
+/* Resamples count outputs from mem[srcPtr] (the 4 samples of history
+ * come first) to mem[dstPtr], in samples.  *accum is the phase, updated
+ * as the scalar loop left it so it can be saved back to RDRAM.
+ *   Returns the source position reached
+ */
+static inline u32 hle_resample(s16* mem, u32 srcPtr, u32 dstPtr, int count,
+                               u32 pitch, u32* accum, const s16* table){
+	u32 acc = *accum;
+
+	while(count > 0){
+		int n = count < HLE_RESAMPLE_RUN ? count : HLE_RESAMPLE_RUN, j = 0;
+		u32 pos[HLE_RESAMPLE_RUN];
+		const s16* lut[HLE_RESAMPLE_RUN];
+
+		for(j=0; j<n; ++j){
+			pos[j] = srcPtr;
+			lut[j] = table + ((acc >> 10) << 2);
+			acc += pitch;
+			srcPtr += acc >> 16;
+			acc &= 0xffff;
+		}
+
+		// Outputs can only be grouped when the run can't overwrite its
+		//   own input (one sample of slack either side for the swizzle)
+		j = 0;
+		if(dstPtr + n + 1 < pos[0] || pos[n-1] + 4 + 1 < dstPtr){
+			for(; j + HLE_MIX_GROUP <= n; j += HLE_MIX_GROUP){
+				s32 o0 = hle_resample_tap(mem, pos[j],   lut[j]);
+				s32 o1 = hle_resample_tap(mem, pos[j+1], lut[j+1]);
+				s32 o2 = hle_resample_tap(mem, pos[j+2], lut[j+2]);
+				s32 o3 = hle_resample_tap(mem, pos[j+3], lut[j+3]);
+				mem[(dstPtr+j)^S]   = o0;
+				mem[(dstPtr+j+1)^S] = o1;
+				mem[(dstPtr+j+2)^S] = o2;
+				mem[(dstPtr+j+3)^S] = o3;
+			}
+		}
+		for(; j < n; ++j)
+			mem[(dstPtr+j)^S] = hle_resample_tap(mem, pos[j], lut[j]);
+
+		dstPtr += n;
+		count  -= n;
+	}
+
+	*accum = acc;
+	return srcPtr;
+}
+
+#endif
@@ -7,6 +7,9 @@
 
 extern "C" {
 #include "hle.h"
+#include "mixer.h"
+#include "adpcm.h"
+#include "resample.h"
 }
 //#include "rsp.h"
 //#define SAFE_MEMORY
@@ -99,7 +102,7 @@ s32 VolRamp_Right;	// m_RightVolTarget
 s16 Env_Dry;		// 0x001C(T8)
 s16 Env_Wet;		// 0x001E(T8)
 
-u8 BufferSpace[0x10000];
+u8 BufferSpace[0x10000] __attribute__((aligned(16)));
 
 short hleMixerWorkArea[256];
 u16 adpcmtable[0x88];
@@ -189,8 +192,6 @@ static void ENVMIXER () {
 	s32 MainL;
 	s32 AuxR;
 	s32 AuxL;
-	int i1,o1,a1,a2=0,a3=0;
-	WORD AuxIncRate=1;
 	short zero[8];
 	memset(zero,0,16);
 	s32 LVol, RVol;
@@ -201,6 +202,9 @@ static void ENVMIXER () {
 	s32 RRamp, LRamp;
 	s32 LAdderStart, RAdderStart, LAdderEnd, RAdderEnd;
 	s32 oMainR, oMainL, oAuxR, oAuxL;
+	s32 vol[4][8];
+	s16 *dst[4];
+	int numDst = 4;
 
 	//envmixcnt++;
 
@@ -233,9 +237,10 @@ static void ENVMIXER () {
 	}
 
 	if(!(flags&A_AUX)) {
-		AuxIncRate=0;
 		aux2=aux3=zero;
+		numDst = 2;
 	}
+	dst[0] = out; dst[1] = aux1; dst[2] = aux2; dst[3] = aux3;
 
 	oMainL = (Dry * (LTrg>>16) + 0x4000) >> 15;
 	oAuxL  = (Wet * (LTrg>>16) + 0x4000)  >> 15;
@@ -296,13 +301,6 @@ static void ENVMIXER () {
 		}
 
 	for (int x = 0; x < 8; x++) {
-		i1=(int)inp[ptr^S];
-		o1=(int)out[ptr^S];
-		a1=(int)aux1[ptr^S];
-		if (AuxIncRate) {
-			a2=(int)aux2[ptr^S];
-			a3=(int)aux3[ptr^S];
-		}
 		// TODO: here...
 		//LAcc = LTrg;
 		//RAcc = RTrg;
@@ -354,60 +352,16 @@ static void ENVMIXER () {
 			}
 		}
 
-		//fprintf (dfile, "%04X ", (LAcc>>16));
-
-		/*MainL = (((s64)Dry*2 * (s64)(LAcc>>16)) + 0x8000) >> 16;
-		MainR = (((s64)Dry*2 * (s64)(RAcc>>16)) + 0x8000) >> 16;
-		AuxL  = (((s64)Wet*2 * (s64)(LAcc>>16)) + 0x8000) >> 16;
-		AuxR  = (((s64)Wet*2 * (s64)(RAcc>>16)) + 0x8000) >> 16;*/
-/*
-		if (MainL>32767) MainL = 32767;
-		else if (MainL<-32768) MainL = -32768;
-		if (MainR>32767) MainR = 32767;
-		else if (MainR<-32768) MainR = -32768;
-		if (AuxL>32767) AuxL = 32767;
-		else if (AuxL<-32768) AuxR = -32768;
-		if (AuxR>32767) AuxR = 32767;
-		else if (AuxR<-32768) AuxR = -32768;*/
-		/*
-		MainR = (Dry * RTrg + 0x10000) >> 15;
-		MainL = (Dry * LTrg + 0x10000) >> 15;
-		AuxR  = (Wet * RTrg + 0x8000)  >> 16;
-		AuxL  = (Wet * LTrg + 0x8000)  >> 16;*/
-
-		o1+=(/*(o1*0x7fff)+*/(i1*MainR)+0x4000)>>15;
-		a1+=(/*(a1*0x7fff)+*/(i1*MainL)+0x4000)>>15;
-
-/*		o1=((s64)(((s64)o1*0xfffe)+((s64)i1*MainR*2)+0x8000)>>16);
-
-		a1=((s64)(((s64)a1*0xfffe)+((s64)i1*MainL*2)+0x8000)>>16);*/
-
-		if(o1>32767) o1=32767;
-		else if(o1<-32768) o1=-32768;
-
-		if(a1>32767) a1=32767;
-		else if(a1<-32768) a1=-32768;
-
-		out[ptr^S]=o1;
-		aux1[ptr^S]=a1;
-		if (AuxIncRate) {
-			//a2=((s64)(((s64)a2*0xfffe)+((s64)i1*AuxR*2)+0x8000)>>16);
-
-			//a3=((s64)(((s64)a3*0xfffe)+((s64)i1*AuxL*2)+0x8000)>>16);
-			a2+=(/*(a2*0x7fff)+*/(i1*AuxR)+0x4000)>>15;
-			a3+=(/*(a3*0x7fff)+*/(i1*AuxL)+0x4000)>>15;
-
-			if(a2>32767) a2=32767;
-			else if(a2<-32768) a2=-32768;
-
-			if(a3>32767) a3=32767;
-			else if(a3<-32768) a3=-32768;
-
-			aux2[ptr^S]=a2;
-			aux3[ptr^S]=a3;
-		}
-		ptr++;
+		// out and aux1 get the main levels, aux2 and aux3 the effect sends
+		vol[0][x^S] = MainR;
+		vol[1][x^S] = MainL;
+		vol[2][x^S] = AuxR;
+		vol[3][x^S] = AuxL;
 	}
+		hle_envmix8(inp+ptr, dst, vol, numDst);
+		for (int k = 0; k < numDst; k++)
+			dst[k] += 8;
+		ptr += 8;
 	}
 
 	/*LAcc = LAdderEnd;
@@ -424,6 +378,7 @@ static void ENVMIXER () {
 	*(s32 *)(hleMixerWorkArea + 16) = LAdderStart; // 12-13
 	*(s32 *)(hleMixerWorkArea + 18) = RAdderStart; // 14-15
 	memcpy(rsp.RDRAM+addy, (u8 *)hleMixerWorkArea,80);
+	hle_rdram_written(addy, 80);
 }
 
 static void ENVMIXERo () { // Borrowed from RCP...
@@ -500,23 +455,18 @@ static void ENVMIXERo () { // Borrowed from RCP...
 	hleMixerWorkArea[4]=AuxR;
 	hleMixerWorkArea[6]=AuxL;
 	memcpy(rsp.RDRAM+addy, (u8 *)hleMixerWorkArea,80);
+	hle_rdram_written(addy, 80);
 }
 
 static void RESAMPLE () {
 	BYTE Flags=(u8)((inst1>>16)&0xff);
 	DWORD Pitch=((inst1&0xffff))<<1;
 	u32 addy = (inst2 & 0xffffff);// + SEGMENTS[(inst2>>24)&0xf];
-	DWORD Accum=0;
-	DWORD location;
-	s16 *lut/*, *lut2*/;
-	short *dst;
+	u32 Accum=0;
 	s16 *src;
-	dst=(short *)(BufferSpace);
 	src=(s16 *)(BufferSpace);
 	u32 srcPtr=(AudioInBuffer/2);
 	u32 dstPtr=(AudioOutBuffer/2);
-	s32 temp;
-	s32 accum;
 /*
 	if (addy > (1024*1024*8))
 		addy = (inst2 & 0xffffff);
@@ -537,49 +487,13 @@ static void RESAMPLE () {
 //		__asm int 3;
 		do {} while (0);
 
-	for(int i=0;i < ((AudioCount+0xf)&0xFFF0)/2;i++)	{
-		//location = (((Accum * 0x40) >> 0x10) * 8);
-		// location is the fractional position between two samples
-		location = (Accum >> 0xa) * 4;
-		lut = (s16*)ResampleLUT + location;
-
-		// mov eax, dword ptr [src+srcPtr];
-		// movsx edx, word ptr [lut];
-		// shl edx, 1
-		// imul edx
-		// test eax, 08000h
-		// setz ecx
-		// shl ecx, 16
-		// xor eax, 08000h
-		// add eax, ecx
-		// and edx, 0f000h
-
-		// imul
-		temp =  ((s32)*(s16*)(src+((srcPtr+0)^S))*((s32)((s16)lut[0])));
-		accum = (s32)(temp >> 15);
-
-		temp = ((s32)*(s16*)(src+((srcPtr+1)^S))*((s32)((s16)lut[1])));
-		accum += (s32)(temp >> 15);
-
-		temp = ((s32)*(s16*)(src+((srcPtr+2)^S))*((s32)((s16)lut[2])));
-		accum += (s32)(temp >> 15);
-
-		temp = ((s32)*(s16*)(src+((srcPtr+3)^S))*((s32)((s16)lut[3])));
-		accum += (s32)(temp >> 15);
-
-		if (accum > 32767) accum = 32767;
-		if (accum < -32768) accum = -32768;
-
-		dst[dstPtr^S] = (accum);
-		dstPtr++;
-		Accum += Pitch;
-		srcPtr += (Accum>>16);
-		Accum&=0xffff;
-	}
+	srcPtr = hle_resample(src, srcPtr, dstPtr, ((AudioCount+0xf)&0xFFF0)/2, Pitch, &Accum, (s16 *)ResampleLUT);
+
 	for (int x=0; x < 4; x++)
 		((u16 *)rsp.RDRAM)[((addy/2)+x)^S] = src[(srcPtr+x)^S];
 	//memcpy (RSWORK, src+srcPtr, 0x8);
 	*(u16 *)(rsp.RDRAM+addy+10) = Accum;
+	hle_rdram_written(addy, 12);
 }
 
 static void SETVOL () {
@@ -650,18 +564,10 @@ static void ADPCM () { // Work in progress! :)
 	BYTE Flags=(u8)(inst1>>16)&0xff;
 	//WORD Gain=(u16)(inst1&0xffff);
 	DWORD Address=(inst2 & 0xffffff);// + SEGMENTS[(inst2>>24)&0xf];
-	WORD inPtr=0;
 	//short *out=(s16 *)(testbuff+(AudioOutBuffer>>2));
 	short *out=(short *)(BufferSpace+AudioOutBuffer);
 	//BYTE *in=(BYTE *)(BufferSpace+AudioInBuffer);
 	short count=(short)AudioCount;
-	BYTE icode;
-	BYTE code;
-	int vscale;
-	WORD index;
-	WORD j;
-	int a[8];
-	short *book1,*book2;
 /*
 	if (Address > (1024*1024*8))
 		Address = (inst2 & 0xffffff);
@@ -677,218 +583,9 @@ static void ADPCM () { // Work in progress! :)
 		}
 	}
 
-	int l1=out[14^S];
-	int l2=out[15^S];
-	int inp1[8];
-	int inp2[8];
-	out+=16;
-	while(count>0)
-	{
-													// the first interation through, these values are
-													// either 0 in the case of A_INIT, from a special
-													// area of memory in the case of A_LOOP or just
-													// the values we calculated the last time
-
-		code=BufferSpace[(AudioInBuffer+inPtr)^S8];
-		index=code&0xf;
-		index<<=4;									// index into the adpcm code table
-		book1=(short *)&adpcmtable[index];
-		book2=book1+8;
-		code>>=4;									// upper nibble is scale
-		vscale=(0x8000>>((12-code)-1));			// very strange. 0x8000 would be .5 in 16:16 format
-													// so this appears to be a fractional scale based
-													// on the 12 based inverse of the scale value.  note
-													// that this could be negative, in which case we do
-													// not use the calculated vscale value... see the
-													// if(code>12) check below
-
-		inPtr++;									// coded adpcm data lies next
-		j=0;
-		while(j<8)									// loop of 8, for 8 coded nibbles from 4 bytes
-													// which yields 8 short pcm values
-		{
-			icode=BufferSpace[(AudioInBuffer+inPtr)^S8];
-			inPtr++;
-
-			inp1[j]=(s16)((icode&0xf0)<<8);			// this will in effect be signed
-			if(code<12)
-				inp1[j]=((int)((int)inp1[j]*(int)vscale)>>16);
-			/*else
-				int catchme=1;*/
-			j++;
-
-			inp1[j]=(s16)((icode&0xf)<<12);
-			if(code<12)
-				inp1[j]=((int)((int)inp1[j]*(int)vscale)>>16);
-			/*else
-				int catchme=1;*/
-			j++;
-		}
-		j=0;
-		while(j<8)
-		{
-			icode=BufferSpace[(AudioInBuffer+inPtr)^S8];
-			inPtr++;
-
-			inp2[j]=(short)((icode&0xf0)<<8);			// this will in effect be signed
-			if(code<12)
-				inp2[j]=((int)((int)inp2[j]*(int)vscale)>>16);
-			/*else
-				int catchme=1;*/
-			j++;
-
-			inp2[j]=(short)((icode&0xf)<<12);
-			if(code<12)
-				inp2[j]=((int)((int)inp2[j]*(int)vscale)>>16);
-			/*else
-				int catchme=1;*/
-			j++;
-		}
-
-		a[0]= (int)book1[0]*(int)l1;
-		a[0]+=(int)book2[0]*(int)l2;
-		a[0]+=(int)inp1[0]*(int)2048;
-
-		a[1] =(int)book1[1]*(int)l1;
-		a[1]+=(int)book2[1]*(int)l2;
-		a[1]+=(int)book2[0]*inp1[0];
-		a[1]+=(int)inp1[1]*(int)2048;
-
-		a[2] =(int)book1[2]*(int)l1;
-		a[2]+=(int)book2[2]*(int)l2;
-		a[2]+=(int)book2[1]*inp1[0];
-		a[2]+=(int)book2[0]*inp1[1];
-		a[2]+=(int)inp1[2]*(int)2048;
-
-		a[3] =(int)book1[3]*(int)l1;
-		a[3]+=(int)book2[3]*(int)l2;
-		a[3]+=(int)book2[2]*inp1[0];
-		a[3]+=(int)book2[1]*inp1[1];
-		a[3]+=(int)book2[0]*inp1[2];
-		a[3]+=(int)inp1[3]*(int)2048;
-
-		a[4] =(int)book1[4]*(int)l1;
-		a[4]+=(int)book2[4]*(int)l2;
-		a[4]+=(int)book2[3]*inp1[0];
-		a[4]+=(int)book2[2]*inp1[1];
-		a[4]+=(int)book2[1]*inp1[2];
-		a[4]+=(int)book2[0]*inp1[3];
-		a[4]+=(int)inp1[4]*(int)2048;
-
-		a[5] =(int)book1[5]*(int)l1;
-		a[5]+=(int)book2[5]*(int)l2;
-		a[5]+=(int)book2[4]*inp1[0];
-		a[5]+=(int)book2[3]*inp1[1];
-		a[5]+=(int)book2[2]*inp1[2];
-		a[5]+=(int)book2[1]*inp1[3];
-		a[5]+=(int)book2[0]*inp1[4];
-		a[5]+=(int)inp1[5]*(int)2048;
-
-		a[6] =(int)book1[6]*(int)l1;
-		a[6]+=(int)book2[6]*(int)l2;
-		a[6]+=(int)book2[5]*inp1[0];
-		a[6]+=(int)book2[4]*inp1[1];
-		a[6]+=(int)book2[3]*inp1[2];
-		a[6]+=(int)book2[2]*inp1[3];
-		a[6]+=(int)book2[1]*inp1[4];
-		a[6]+=(int)book2[0]*inp1[5];
-		a[6]+=(int)inp1[6]*(int)2048;
-
-		a[7] =(int)book1[7]*(int)l1;
-		a[7]+=(int)book2[7]*(int)l2;
-		a[7]+=(int)book2[6]*inp1[0];
-		a[7]+=(int)book2[5]*inp1[1];
-		a[7]+=(int)book2[4]*inp1[2];
-		a[7]+=(int)book2[3]*inp1[3];
-		a[7]+=(int)book2[2]*inp1[4];
-		a[7]+=(int)book2[1]*inp1[5];
-		a[7]+=(int)book2[0]*inp1[6];
-		a[7]+=(int)inp1[7]*(int)2048;
-
-		for(j=0;j<8;j++)
-		{
-			a[j^S]>>=11;
-			if(a[j^S]>32767) a[j^S]=32767;
-			else if(a[j^S]<-32768) a[j^S]=-32768;
-			*(out++)=a[j^S];
-		}
-		l1=a[6];
-		l2=a[7];
-
-		a[0]= (int)book1[0]*(int)l1;
-		a[0]+=(int)book2[0]*(int)l2;
-		a[0]+=(int)inp2[0]*(int)2048;
-
-		a[1] =(int)book1[1]*(int)l1;
-		a[1]+=(int)book2[1]*(int)l2;
-		a[1]+=(int)book2[0]*inp2[0];
-		a[1]+=(int)inp2[1]*(int)2048;
-
-		a[2] =(int)book1[2]*(int)l1;
-		a[2]+=(int)book2[2]*(int)l2;
-		a[2]+=(int)book2[1]*inp2[0];
-		a[2]+=(int)book2[0]*inp2[1];
-		a[2]+=(int)inp2[2]*(int)2048;
-
-		a[3] =(int)book1[3]*(int)l1;
-		a[3]+=(int)book2[3]*(int)l2;
-		a[3]+=(int)book2[2]*inp2[0];
-		a[3]+=(int)book2[1]*inp2[1];
-		a[3]+=(int)book2[0]*inp2[2];
-		a[3]+=(int)inp2[3]*(int)2048;
-
-		a[4] =(int)book1[4]*(int)l1;
-		a[4]+=(int)book2[4]*(int)l2;
-		a[4]+=(int)book2[3]*inp2[0];
-		a[4]+=(int)book2[2]*inp2[1];
-		a[4]+=(int)book2[1]*inp2[2];
-		a[4]+=(int)book2[0]*inp2[3];
-		a[4]+=(int)inp2[4]*(int)2048;
-
-		a[5] =(int)book1[5]*(int)l1;
-		a[5]+=(int)book2[5]*(int)l2;
-		a[5]+=(int)book2[4]*inp2[0];
-		a[5]+=(int)book2[3]*inp2[1];
-		a[5]+=(int)book2[2]*inp2[2];
-		a[5]+=(int)book2[1]*inp2[3];
-		a[5]+=(int)book2[0]*inp2[4];
-		a[5]+=(int)inp2[5]*(int)2048;
-
-		a[6] =(int)book1[6]*(int)l1;
-		a[6]+=(int)book2[6]*(int)l2;
-		a[6]+=(int)book2[5]*inp2[0];
-		a[6]+=(int)book2[4]*inp2[1];
-		a[6]+=(int)book2[3]*inp2[2];
-		a[6]+=(int)book2[2]*inp2[3];
-		a[6]+=(int)book2[1]*inp2[4];
-		a[6]+=(int)book2[0]*inp2[5];
-		a[6]+=(int)inp2[6]*(int)2048;
-
-		a[7] =(int)book1[7]*(int)l1;
-		a[7]+=(int)book2[7]*(int)l2;
-		a[7]+=(int)book2[6]*inp2[0];
-		a[7]+=(int)book2[5]*inp2[1];
-		a[7]+=(int)book2[4]*inp2[2];
-		a[7]+=(int)book2[3]*inp2[3];
-		a[7]+=(int)book2[2]*inp2[4];
-		a[7]+=(int)book2[1]*inp2[5];
-		a[7]+=(int)book2[0]*inp2[6];
-		a[7]+=(int)inp2[7]*(int)2048;
-
-		for(j=0;j<8;j++)
-		{
-			a[j^S]>>=11;
-			if(a[j^S]>32767) a[j^S]=32767;
-			else if(a[j^S]<-32768) a[j^S]=-32768;
-			*(out++)=a[j^S];
-		}
-		l1=a[6];
-		l2=a[7];
-
-		count-=32;
-	}
-	out-=16;
+	out = hle_adpcm_decode(BufferSpace, AudioInBuffer, out, count, adpcmtable, 4, 12);
 	memcpy(&rsp.RDRAM[Address],out,32);
+	hle_rdram_written(Address, 32);
 }
 
 static void LOADBUFF () { // memcpy causes static... endianess issue :(
@@ -907,6 +604,7 @@ static void SAVEBUFF () { // memcpy causes static... endianess issue :(
 		return;
 	v0 = (inst2 & 0xfffffc);// + SEGMENTS[(inst2>>24)&0xf];
 	memcpy (rsp.RDRAM+v0, BufferSpace+(AudioOutBuffer&0xFFFC), (AudioCount+3)&0xFFFC);
+	hle_rdram_written(v0, (AudioCount+3)&0xFFFC);
 }
 
 static void SEGMENT () { // Should work
@@ -1011,22 +709,12 @@ static void MIXER () { // Fixed a sign issue... 03-14-01
 	u32 dmemout = (u16)(inst2 & 0xFFFF);
 	//u8  flags   = (u8)((inst1 >> 16) & 0xff);
 	s32 gain    = (s16)(inst1 & 0xFFFF);
-	s32 temp;
 
 	if (AudioCount == 0)
 		return;
 
-	for (int x=0; x < AudioCount; x+=2) { // I think I can do this a lot easier
-		temp = (*(s16 *)(BufferSpace+dmemin+x) * gain) >> 15;
-		temp += *(s16 *)(BufferSpace+dmemout+x);
-
-		if ((s32)temp > 32767)
-			temp = 32767;
-		if ((s32)temp < -32768)
-			temp = -32768;
-
-		*(u16 *)(BufferSpace+dmemout+x) = (u16)(temp & 0xFFFF);
-	}
+	hle_mix_gain((s16 *)(BufferSpace+dmemout), (s16 *)(BufferSpace+dmemin),
+	             gain, (AudioCount+1)/2);
 }
 
 // TOP Performance Hogs:
@@ -9,6 +9,9 @@
 
 extern "C" {
 #include "hle.h"
+#include "mixer.h"
+#include "adpcm.h"
+#include "resample.h"
 }
 
 extern u8 BufferSpace[0x10000];
@@ -72,39 +75,22 @@ static void ADPCM2 () { // Verified to be 100% Accurate...
 	BYTE Flags=(u8)(inst1>>16)&0xff;
 	//WORD Gain=(u16)(inst1&0xffff);
 	DWORD Address=(inst2 & 0xffffff);// + SEGMENTS[(inst2>>24)&0xf];
-	WORD inPtr=0;
 	//short *out=(s16 *)(testbuff+(AudioOutBuffer>>2));
 	short *out=(short *)(BufferSpace+AudioOutBuffer);
 	//BYTE *in=(BYTE *)(BufferSpace+AudioInBuffer);
 	short count=(short)AudioCount;
-	BYTE icode;
-	BYTE code;
-	int vscale;
-	WORD index;
-	WORD j;
-	int a[8];
-	short *book1,*book2;
 
 	u8 srange;
-	u8 inpinc;
-	u8 mask1;
-	u8 mask2;
-	u8 shifter;
+	int bits;
 
 	memset(out,0,32);
 
 	if (Flags & 0x4) { // Tricky lil Zelda MM and ABI2!!! hahaha I know your secrets! :DDD
 		srange = 0xE;
-		inpinc = 0x5;
-		mask1 = 0xC0;
-		mask2 = 0x30;
-		shifter = 10;
+		bits = 2;
 	} else {
 		srange = 0xC;
-		inpinc = 0x9;
-		mask1 = 0xf0;
-		mask2 = 0x0f;
-		shifter = 12;
+		bits = 4;
 	}
 
 	if(!(Flags&0x1))
@@ -127,224 +113,9 @@ static void ADPCM2 () { // Verified to be 100% Accurate...
 		}
 	}
 
-	int l1=out[14^S];
-	int l2=out[15^S];
-	int inp1[8];
-	int inp2[8];
-	out+=16;
-	while(count>0) {
-		code=BufferSpace[(AudioInBuffer+inPtr)^S8];
-		index=code&0xf;
-		index<<=4;
-		book1=(short *)&adpcmtable[index];
-		book2=book1+8;
-		code>>=4;
-		vscale=(0x8000>>((srange-code)-1));
-
-		inPtr++;
-		j=0;
-
-		while(j<8) {
-			icode=BufferSpace[(AudioInBuffer+inPtr)^S8];
-			inPtr++;
-
-			inp1[j]=(s16)((icode&mask1) << 8);			// this will in effect be signed
-			if(code<srange) inp1[j]=((int)((int)inp1[j]*(int)vscale)>>16);
-			//else int catchme=1;
-			j++;
-
-			inp1[j]=(s16)((icode&mask2)<<shifter);
-			if(code<srange)	inp1[j]=((int)((int)inp1[j]*(int)vscale)>>16);
-			//else int catchme=1;
-			j++;
-
-			if (Flags & 4) {
-				inp1[j]=(s16)((icode&0xC) << 12);			// this will in effect be signed
-				if(code < 0xE) inp1[j]=((int)((int)inp1[j]*(int)vscale)>>16);
-				//else int catchme=1;
-				j++;
-
-				inp1[j]=(s16)((icode&0x3) << 14);
-				if(code < 0xE) inp1[j]=((int)((int)inp1[j]*(int)vscale)>>16);
-				//else int catchme=1;
-				j++;
-			} // end flags
-		} // end while
-
-
-
-		j=0;
-		while(j<8) {
-			icode=BufferSpace[(AudioInBuffer+inPtr)^S8];
-			inPtr++;
-
-			inp2[j]=(s16)((icode&mask1) << 8);
-			if(code<srange) inp2[j]=((int)((int)inp2[j]*(int)vscale)>>16);
-			//else int catchme=1;
-			j++;
-
-			inp2[j]=(s16)((icode&mask2)<<shifter);
-			if(code<srange)	inp2[j]=((int)((int)inp2[j]*(int)vscale)>>16);
-			//else int catchme=1;
-			j++;
-
-			if (Flags & 4) {
-				inp2[j]=(s16)((icode&0xC) << 12);
-				if(code < 0xE) inp2[j]=((int)((int)inp2[j]*(int)vscale)>>16);
-				//else int catchme=1;
-				j++;
-
-				inp2[j]=(s16)((icode&0x3) << 14);
-				if(code < 0xE) inp2[j]=((int)((int)inp2[j]*(int)vscale)>>16);
-				//else int catchme=1;
-				j++;
-			} // end flags
-		}
-
-		a[0]= (int)book1[0]*(int)l1;
-		a[0]+=(int)book2[0]*(int)l2;
-		a[0]+=(int)inp1[0]*(int)2048;
-
-		a[1] =(int)book1[1]*(int)l1;
-		a[1]+=(int)book2[1]*(int)l2;
-		a[1]+=(int)book2[0]*inp1[0];
-		a[1]+=(int)inp1[1]*(int)2048;
-
-		a[2] =(int)book1[2]*(int)l1;
-		a[2]+=(int)book2[2]*(int)l2;
-		a[2]+=(int)book2[1]*inp1[0];
-		a[2]+=(int)book2[0]*inp1[1];
-		a[2]+=(int)inp1[2]*(int)2048;
-
-		a[3] =(int)book1[3]*(int)l1;
-		a[3]+=(int)book2[3]*(int)l2;
-		a[3]+=(int)book2[2]*inp1[0];
-		a[3]+=(int)book2[1]*inp1[1];
-		a[3]+=(int)book2[0]*inp1[2];
-		a[3]+=(int)inp1[3]*(int)2048;
-
-		a[4] =(int)book1[4]*(int)l1;
-		a[4]+=(int)book2[4]*(int)l2;
-		a[4]+=(int)book2[3]*inp1[0];
-		a[4]+=(int)book2[2]*inp1[1];
-		a[4]+=(int)book2[1]*inp1[2];
-		a[4]+=(int)book2[0]*inp1[3];
-		a[4]+=(int)inp1[4]*(int)2048;
-
-		a[5] =(int)book1[5]*(int)l1;
-		a[5]+=(int)book2[5]*(int)l2;
-		a[5]+=(int)book2[4]*inp1[0];
-		a[5]+=(int)book2[3]*inp1[1];
-		a[5]+=(int)book2[2]*inp1[2];
-		a[5]+=(int)book2[1]*inp1[3];
-		a[5]+=(int)book2[0]*inp1[4];
-		a[5]+=(int)inp1[5]*(int)2048;
-
-		a[6] =(int)book1[6]*(int)l1;
-		a[6]+=(int)book2[6]*(int)l2;
-		a[6]+=(int)book2[5]*inp1[0];
-		a[6]+=(int)book2[4]*inp1[1];
-		a[6]+=(int)book2[3]*inp1[2];
-		a[6]+=(int)book2[2]*inp1[3];
-		a[6]+=(int)book2[1]*inp1[4];
-		a[6]+=(int)book2[0]*inp1[5];
-		a[6]+=(int)inp1[6]*(int)2048;
-
-		a[7] =(int)book1[7]*(int)l1;
-		a[7]+=(int)book2[7]*(int)l2;
-		a[7]+=(int)book2[6]*inp1[0];
-		a[7]+=(int)book2[5]*inp1[1];
-		a[7]+=(int)book2[4]*inp1[2];
-		a[7]+=(int)book2[3]*inp1[3];
-		a[7]+=(int)book2[2]*inp1[4];
-		a[7]+=(int)book2[1]*inp1[5];
-		a[7]+=(int)book2[0]*inp1[6];
-		a[7]+=(int)inp1[7]*(int)2048;
-
-		for(j=0;j<8;j++)
-		{
-			a[j^S]>>=11;
-			if(a[j^S]>32767) a[j^S]=32767;
-			else if(a[j^S]<-32768) a[j^S]=-32768;
-			*(out++)=a[j^S];
-		}
-		l1=a[6];
-		l2=a[7];
-
-		a[0]= (int)book1[0]*(int)l1;
-		a[0]+=(int)book2[0]*(int)l2;
-		a[0]+=(int)inp2[0]*(int)2048;
-
-		a[1] =(int)book1[1]*(int)l1;
-		a[1]+=(int)book2[1]*(int)l2;
-		a[1]+=(int)book2[0]*inp2[0];
-		a[1]+=(int)inp2[1]*(int)2048;
-
-		a[2] =(int)book1[2]*(int)l1;
-		a[2]+=(int)book2[2]*(int)l2;
-		a[2]+=(int)book2[1]*inp2[0];
-		a[2]+=(int)book2[0]*inp2[1];
-		a[2]+=(int)inp2[2]*(int)2048;
-
-		a[3] =(int)book1[3]*(int)l1;
-		a[3]+=(int)book2[3]*(int)l2;
-		a[3]+=(int)book2[2]*inp2[0];
-		a[3]+=(int)book2[1]*inp2[1];
-		a[3]+=(int)book2[0]*inp2[2];
-		a[3]+=(int)inp2[3]*(int)2048;
-
-		a[4] =(int)book1[4]*(int)l1;
-		a[4]+=(int)book2[4]*(int)l2;
-		a[4]+=(int)book2[3]*inp2[0];
-		a[4]+=(int)book2[2]*inp2[1];
-		a[4]+=(int)book2[1]*inp2[2];
-		a[4]+=(int)book2[0]*inp2[3];
-		a[4]+=(int)inp2[4]*(int)2048;
-
-		a[5] =(int)book1[5]*(int)l1;
-		a[5]+=(int)book2[5]*(int)l2;
-		a[5]+=(int)book2[4]*inp2[0];
-		a[5]+=(int)book2[3]*inp2[1];
-		a[5]+=(int)book2[2]*inp2[2];
-		a[5]+=(int)book2[1]*inp2[3];
-		a[5]+=(int)book2[0]*inp2[4];
-		a[5]+=(int)inp2[5]*(int)2048;
-
-		a[6] =(int)book1[6]*(int)l1;
-		a[6]+=(int)book2[6]*(int)l2;
-		a[6]+=(int)book2[5]*inp2[0];
-		a[6]+=(int)book2[4]*inp2[1];
-		a[6]+=(int)book2[3]*inp2[2];
-		a[6]+=(int)book2[2]*inp2[3];
-		a[6]+=(int)book2[1]*inp2[4];
-		a[6]+=(int)book2[0]*inp2[5];
-		a[6]+=(int)inp2[6]*(int)2048;
-
-		a[7] =(int)book1[7]*(int)l1;
-		a[7]+=(int)book2[7]*(int)l2;
-		a[7]+=(int)book2[6]*inp2[0];
-		a[7]+=(int)book2[5]*inp2[1];
-		a[7]+=(int)book2[4]*inp2[2];
-		a[7]+=(int)book2[3]*inp2[3];
-		a[7]+=(int)book2[2]*inp2[4];
-		a[7]+=(int)book2[1]*inp2[5];
-		a[7]+=(int)book2[0]*inp2[6];
-		a[7]+=(int)inp2[7]*(int)2048;
-
-		for(j=0;j<8;j++)
-		{
-			a[j^S]>>=11;
-			if(a[j^S]>32767) a[j^S]=32767;
-			else if(a[j^S]<-32768) a[j^S]=-32768;
-			*(out++)=a[j^S];
-		}
-		l1=a[6];
-		l2=a[7];
-
-		count-=32;
-	}
-	out-=16;
+	out = hle_adpcm_decode(BufferSpace, AudioInBuffer, out, count, adpcmtable, bits, srange);
 	memcpy(&rsp.RDRAM[Address],out,32);
+	hle_rdram_written(Address, 32);
 }
 
 static void CLEARBUFF2 () {
@@ -366,6 +137,7 @@ static void SAVEBUFF2 () { // Needs accuracy verification...
 	u32 cnt = (((inst1 >> 0xC)+3)&0xFFC);
 	v0 = (inst2 & 0xfffffc);// + SEGMENTS[(inst2>>24)&0xf];
 	memcpy (rsp.RDRAM+v0, BufferSpace+(inst1&0xfffc), (cnt+3)&0xFFFC);
+	hle_rdram_written(v0, (cnt+3)&0xFFFC);
 }
 
 
@@ -374,20 +146,9 @@ static void MIXER2 () { // Needs accuracy verification...
 	u16 dmemout = (u16)(inst2 & 0xFFFF);
 	u32 count   = ((inst1 >> 12) & 0xFF0);
 	s32 gain    = (s16)(inst1 & 0xFFFF);
-	s32 temp;
-
-	for (unsigned int x=0; x < count; x+=2) { // I think I can do this a lot easier
-
-		temp = (*(s16 *)(BufferSpace+dmemin+x) * gain) >> 15;
-		temp += *(s16 *)(BufferSpace+dmemout+x);
-
-		if ((s32)temp > 32767)
-			temp = 32767;
-		if ((s32)temp < -32768)
-			temp = -32768;
 
-		*(u16 *)(BufferSpace+dmemout+x) = (u16)(temp & 0xFFFF);
-	}
+	hle_mix_gain((s16 *)(BufferSpace+dmemout), (s16 *)(BufferSpace+dmemin),
+	             gain, count/2);
 }
 
 
@@ -395,17 +156,11 @@ static void RESAMPLE2 () {
 	BYTE Flags=(u8)((inst1>>16)&0xff);
 	DWORD Pitch=((inst1&0xffff))<<1;
 	u32 addy = (inst2 & 0xffffff);// + SEGMENTS[(inst2>>24)&0xf];
-	DWORD Accum=0;
-	DWORD location;
-	s16 *lut;
-	short *dst;
+	u32 Accum=0;
 	s16 *src;
-	dst=(short *)(BufferSpace);
 	src=(s16 *)(BufferSpace);
 	u32 srcPtr=(AudioInBuffer/2);
 	u32 dstPtr=(AudioOutBuffer/2);
-	s32 temp;
-	s32 accum;
 
 	if (addy > (1024*1024*8))
 		addy = (inst2 & 0xffffff);
@@ -424,35 +179,12 @@ static void RESAMPLE2 () {
 //	if ((Flags & 0x2))
 //		__asm int 3;
 
-	for(int i=0;i < ((AudioCount+0xf)&0xFFF0)/2;i++)	{
-		location = (((Accum * 0x40) >> 0x10) * 8);
-		//location = (Accum >> 0xa) << 0x3;
-		lut = (s16 *)(((u8 *)ResampleLUT) + location);
-
-		temp =  ((s32)*(s16*)(src+((srcPtr+0)^S))*((s32)((s16)lut[0])));
-		accum = (s32)(temp >> 15);
-
-		temp = ((s32)*(s16*)(src+((srcPtr+1)^S))*((s32)((s16)lut[1])));
-		accum += (s32)(temp >> 15);
-
-		temp = ((s32)*(s16*)(src+((srcPtr+2)^S))*((s32)((s16)lut[2])));
-		accum += (s32)(temp >> 15);
+	srcPtr = hle_resample(src, srcPtr, dstPtr, ((AudioCount+0xf)&0xFFF0)/2, Pitch, &Accum, (s16 *)ResampleLUT);
 
-		temp = ((s32)*(s16*)(src+((srcPtr+3)^S))*((s32)((s16)lut[3])));
-		accum += (s32)(temp >> 15);
-
-		if (accum > 32767) accum = 32767;
-		if (accum < -32768) accum = -32768;
-
-		dst[dstPtr^S] = (s16)(accum);
-		dstPtr++;
-		Accum += Pitch;
-		srcPtr += (Accum>>16);
-		Accum&=0xffff;
-	}
 	for (int x=0; x < 4; x++)
 		((u16 *)rsp.RDRAM)[((addy/2)+x)^S] = src[(srcPtr+x)^S];
 	*(u16 *)(rsp.RDRAM+addy+10) = (u16)Accum;
+	hle_rdram_written(addy, 12);
 	//memcpy (RSWORK, src+srcPtr, 0x8);
 }
 
@@ -507,6 +239,34 @@ static void ENVSETUP2 () {
 	//fprintf (dfile, "	env[0] = %X / env[1] = %X / env[2] = %X / env[3] = %X\n", env[0], env[1], env[2], env[3]);
 }
 
+// Eight samples of ENVMIXER2 at one envelope step: the dry sends first,
+//   then the wet ones scaled again by the effect level.  The buffers are
+//   16 byte aligned so a block never half overlaps another
+static void ENVMIX2_HALF(s16 *in, s16 *dryL, s16 *dryR, s16 *wet0, s16 *wet1,
+                         u16 envL, u16 envR, u16 envWet, s16 *v2) {
+	s16 vec9[8] __attribute__((aligned(16)));
+	s16 vec10[8] __attribute__((aligned(16)));
+	int x;
+
+	for (x=0; x < 0x8; x++) {
+		vec9[x]  = (s16)(((s32)in[x] * (u32)envL) >> 0x10) ^ v2[0];
+		vec10[x] = (s16)(((s32)in[x] * (u32)envR) >> 0x10) ^ v2[1];
+	}
+	hle_mix_add(dryL, vec9, 8);
+	hle_mix_add(dryR, vec10, 8);
+	for (x=0; x < 0x8; x++) {
+		vec9[x]  = (s16)(((s32)vec9[x]  * (u32)envWet) >> 0x10) ^ v2[2];
+		vec10[x] = (s16)(((s32)vec10[x] * (u32)envWet) >> 0x10) ^ v2[3];
+	}
+	if (inst1 & 0x10) {
+		hle_mix_add(wet0, vec10, 8);
+		hle_mix_add(wet1, vec9, 8);
+	} else {
+		hle_mix_add(wet0, vec9, 8);
+		hle_mix_add(wet1, vec10, 8);
+	}
+}
+
 static void ENVMIXER2 () {
 	//fprintf (dfile, "ENVMIXER: inst1 = %08X, inst2 = %08X\n", inst1, inst2);
 
@@ -515,8 +275,6 @@ static void ENVMIXER2 () {
 	s32 count;
 	u32 adder;
 
-	s16 vec9, vec10;
-
 	s16 v2[8];
 
 	//__asm int 3;
@@ -546,63 +304,9 @@ static void ENVMIXER2 () {
 
 
 	while (count > 0) {
-		int temp, x;
-		for (x=0; x < 0x8; x++) {
-			vec9  = (s16)(((s32)buffs3[x^S] * (u32)env[0]) >> 0x10) ^ v2[0];
-			vec10 = (s16)(((s32)buffs3[x^S] * (u32)env[2]) >> 0x10) ^ v2[1];
-			temp = bufft6[x^S] + vec9;
-			if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-			bufft6[x^S] = temp;
-			temp = bufft7[x^S] + vec10;
-			if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-			bufft7[x^S] = temp;
-			vec9  = (s16)(((s32)vec9  * (u32)env[4]) >> 0x10) ^ v2[2];
-			vec10 = (s16)(((s32)vec10 * (u32)env[4]) >> 0x10) ^ v2[3];
-			if (inst1 & 0x10) {
-				temp = buffs0[x^S] + vec10;
-				if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-				buffs0[x^S] = temp;
-				temp = buffs1[x^S] + vec9;
-				if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-				buffs1[x^S] = temp;
-			} else {
-				temp = buffs0[x^S] + vec9;
-				if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-				buffs0[x^S] = temp;
-				temp = buffs1[x^S] + vec10;
-				if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-				buffs1[x^S] = temp;
-			}
-		}
-
+		ENVMIX2_HALF(buffs3, bufft6, bufft7, buffs0, buffs1, env[0], env[2], env[4], v2);
 		if (!isMKABI)
-		for (x=0x8; x < 0x10; x++) {
-			vec9  = (s16)(((s32)buffs3[x^S] * (u32)env[1]) >> 0x10) ^ v2[0];
-			vec10 = (s16)(((s32)buffs3[x^S] * (u32)env[3]) >> 0x10) ^ v2[1];
-			temp = bufft6[x^S] + vec9;
-			if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-			bufft6[x^S] = temp;
-			temp = bufft7[x^S] + vec10;
-			if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-			bufft7[x^S] = temp;
-			vec9  = (s16)(((s32)vec9  * (u32)env[5]) >> 0x10) ^ v2[2];
-			vec10 = (s16)(((s32)vec10 * (u32)env[5]) >> 0x10) ^ v2[3];
-			if (inst1 & 0x10) {
-				temp = buffs0[x^S] + vec10;
-				if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-				buffs0[x^S] = temp;
-				temp = buffs1[x^S] + vec9;
-				if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-				buffs1[x^S] = temp;
-			} else {
-				temp = buffs0[x^S] + vec9;
-				if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-				buffs0[x^S] = temp;
-				temp = buffs1[x^S] + vec10;
-				if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-				buffs1[x^S] = temp;
-			}
-		}
+			ENVMIX2_HALF(buffs3+8, bufft6+8, bufft7+8, buffs0+8, buffs1+8, env[1], env[3], env[5], v2);
 		bufft6 += adder; bufft7 += adder;
 		buffs0 += adder; buffs1 += adder;
 		buffs3 += adder; count  -= adder;
@@ -721,16 +425,7 @@ static void ADDMIXER () {
 	u16 InBuffer  = (inst2 >> 16);
 	u16 OutBuffer = inst2 & 0xffff;
 
-	s16 *inp, *outp;
-	s32 temp;
-	inp  = (s16 *)(BufferSpace + InBuffer);
-	outp = (s16 *)(BufferSpace + OutBuffer);
-	for (int cntr = 0; cntr < Count; cntr+=2) {
-		temp = *outp + *inp;
-		if (temp > 32767)  temp = 32767; if (temp < -32768) temp = -32768;
-		*(outp++) = temp;
-		inp++;
-	}
+	hle_mix_add((s16 *)(BufferSpace + OutBuffer), (s16 *)(BufferSpace + InBuffer), Count/2);
 }
 
 static void HILOGAIN () {
@@ -738,21 +433,8 @@ static void HILOGAIN () {
 	u16 out = (inst2 >> 16) & 0xffff;
 	s16 hi  = (s16)((inst1 >> 4) & 0xf000);
 	u16 lo  = (inst1 >> 20) & 0xf;
-	s16 *src;
-
-	src = (s16 *)(BufferSpace+out);
-	s32 tmp, val;
 
-	while(cnt) {
-		val = (s32)*src;
-		//tmp = ((val * (s32)hi) + ((u64)(val * lo) << 16) >> 16);
-		tmp = ((val * (s32)hi) >> 16) + (u32)(val * lo);
-		if ((s32)tmp > 32767) tmp = 32767;
-		else if ((s32)tmp < -32768) tmp = -32768;
-		*src = tmp;
-		src++;
-		cnt -= 2;
-	}
+	hle_hilogain((s16 *)(BufferSpace+out), hi, lo, cnt/2);
 }
 
 static void FILTER2 () {
@@ -877,6 +559,7 @@ static void FILTER2 () {
 			}
 //			memcpy (rsp.RDRAM+(inst2&0xFFFFFF), dmem+0xFB0, 0x20);
 			memcpy (save, inp2-8, 0x10);
+			hle_rdram_written(inst2&0xFFFFFF, 0x10);
 			memcpy (BufferSpace+(inst1&0xffff), outbuff, cnt);
 }
 
@@ -9,6 +9,9 @@
 
 extern "C" {
 #include "hle.h"
+#include "mixer.h"
+#include "adpcm.h"
+#include "resample.h"
 }
 
 static void SPNOOP () {
@@ -87,11 +90,8 @@ static void ENVMIXER3 () {
 	short *aux1=(short *)(BufferSpace+0xB40);
 	short *aux2=(short *)(BufferSpace+0xCB0);
 	short *aux3=(short *)(BufferSpace+0xE20);
-	s32 MainR;
-	s32 MainL;
-	s32 AuxR;
-	s32 AuxL;
-	int i1,o1,a1,a2,a3;
+	s32 vol[4][8];
+	s16 *dst[4] = { out, aux1, aux2, aux3 };
 	//WORD AuxIncRate=1;
 	short zero[8];
 	memset(zero,0,16);
@@ -176,50 +176,18 @@ static void ENVMIXER3 () {
 			}
 		}
 // ****************************************************************
-		MainL = ((Dry * LVol) + 0x4000) >> 15;
-		MainR = ((Dry * RVol) + 0x4000) >> 15;
-
-		o1 = out [y^S];
-		a1 = aux1[y^S];
-		i1 = inp [y^S];
-
-		o1+=((i1*MainL)+0x4000)>>15;
-		a1+=((i1*MainR)+0x4000)>>15;
-
-// ****************************************************************
-
-		if(o1>32767) o1=32767;
-		else if(o1<-32768) o1=-32768;
-
-		if(a1>32767) a1=32767;
-		else if(a1<-32768) a1=-32768;
-
-// ****************************************************************
-
-		out[y^S]=o1;
-		aux1[y^S]=a1;
-
-// ****************************************************************
-		//if (!(flags&A_AUX)) {
-			a2 = aux2[y^S];
-			a3 = aux3[y^S];
-
-			AuxL  = ((Wet * LVol) + 0x4000) >> 15;
-			AuxR  = ((Wet * RVol) + 0x4000) >> 15;
-
-			a2+=((i1*AuxL)+0x4000)>>15;
-			a3+=((i1*AuxR)+0x4000)>>15;
-
-			if(a2>32767) a2=32767;
-			else if(a2<-32768) a2=-32768;
-
-			if(a3>32767) a3=32767;
-			else if(a3<-32768) a3=-32768;
-
-			aux2[y^S]=a2;
-			aux3[y^S]=a3;
+		// out and aux1 get the main levels, aux2 and aux3 the effect sends
+		vol[0][(y^S)&7] = ((Dry * LVol) + 0x4000) >> 15;
+		vol[1][(y^S)&7] = ((Dry * RVol) + 0x4000) >> 15;
+		vol[2][(y^S)&7] = ((Wet * LVol) + 0x4000) >> 15;
+		vol[3][(y^S)&7] = ((Wet * RVol) + 0x4000) >> 15;
+
+		if ((y&7) == 7) {
+			hle_envmix8(inp+(y&~7), dst, vol, 4);
+			for (int k = 0; k < 4; k++)
+				dst[k] += 8;
 		}
-	//}
+	}
 
 	*(s16 *)(hleMixerWorkArea +  0) = Wet; // 0-1
 	*(s16 *)(hleMixerWorkArea +  2) = Dry; // 2-3
@@ -235,6 +203,7 @@ static void ENVMIXER3 () {
 	*(s16 *)(hleMixerWorkArea + 22) = RSig; // 22-23
 	//*(u32 *)(hleMixerWorkArea + 24) = 0x13371337; // 22-23
 	memcpy(rsp.RDRAM+addy, (u8 *)hleMixerWorkArea,80);
+	hle_rdram_written(addy, 80);
 }
 //*/
 static void ENVMIXER3o () {
@@ -396,6 +365,7 @@ static void ENVMIXER3o () {
 	*(s32 *)(hleMixerWorkArea + 12) = LAcc; // 12-13
 	*(s32 *)(hleMixerWorkArea + 14) = RAcc; // 14-15
 	memcpy(rsp.RDRAM+addy, (u8 *)hleMixerWorkArea,80);
+	hle_rdram_written(addy, 80);
 }
 /*
 static void ENVMIXER3 () { // Borrowed from RCP...
@@ -474,6 +444,7 @@ static void ENVMIXER3 () { // Borrowed from RCP...
 	hleMixerWorkArea[4]=AuxR;
 	hleMixerWorkArea[6]=AuxL;
 	memcpy(rsp.RDRAM+addy, (u8 *)hleMixerWorkArea,80);
+	hle_rdram_written(addy, 80);
 }*/
 
 
@@ -488,19 +459,9 @@ static void MIXER3 () { // Needs accuracy verification...
 	u16 dmemout = (u16)(inst2 & 0xFFFF) + 0x4f0;
 	//u8  flags   = (u8)((inst1 >> 16) & 0xff);
 	s32 gain    = (s16)(inst1 & 0xFFFF);
-	s32 temp;
-
-	for (int x=0; x < 0x170; x+=2) { // I think I can do this a lot easier
-		temp = (*(s16 *)(BufferSpace+dmemin+x) * gain) >> 15;
-		temp += *(s16 *)(BufferSpace+dmemout+x);
 
-		if ((s32)temp > 32767)
-			temp = 32767;
-		if ((s32)temp < -32768)
-			temp = -32768;
-
-		*(u16 *)(BufferSpace+dmemout+x) = (u16)(temp & 0xFFFF);
-	}
+	hle_mix_gain((s16 *)(BufferSpace+dmemout), (s16 *)(BufferSpace+dmemin),
+	             gain, 0x170/2);
 }
 
 static void LOADBUFF3 () {
@@ -517,6 +478,7 @@ static void SAVEBUFF3 () {
 	v0 = (inst2 & 0xfffffc);
 	u32 src = (inst1&0xffc)+0x4f0;
 	memcpy (rsp.RDRAM+v0, BufferSpace+src, cnt);
+	hle_rdram_written(v0, cnt);
 }
 
 static void LOADADPCM3 () { // Loads an ADPCM table - Works 100% Now 03-13-01
@@ -567,13 +529,6 @@ static void ADPCM3 () { // Verified to be 100% Accurate...
 	short *out=(short *)(BufferSpace+(inst2&0xfff)+0x4f0);
 	//BYTE *in=(BYTE *)(BufferSpace+((inst2>>12)&0xf)+0x4f0);
 	short count=(short)((inst2 >> 16)&0xfff);
-	BYTE icode;
-	BYTE code;
-	int vscale;
-	WORD index;
-	WORD j;
-	int a[8];
-	short *book1,*book2;
 
 	memset(out,0,32);
 
@@ -597,238 +552,20 @@ static void ADPCM3 () { // Verified to be 100% Accurate...
 		}
 	}
 
-	int l1=out[14^S];
-	int l2=out[15^S];
-	int inp1[8];
-	int inp2[8];
-	out+=16;
-	while(count>0)
-	{
-													// the first interation through, these values are
-													// either 0 in the case of A_INIT, from a special
-													// area of memory in the case of A_LOOP or just
-													// the values we calculated the last time
-
-		code=BufferSpace[(0x4f0+inPtr)^S8];
-		index=code&0xf;
-		index<<=4;									// index into the adpcm code table
-		book1=(short *)&adpcmtable[index];
-		book2=book1+8;
-		code>>=4;									// upper nibble is scale
-		vscale=(0x8000>>((12-code)-1));			// very strange. 0x8000 would be .5 in 16:16 format
-													// so this appears to be a fractional scale based
-													// on the 12 based inverse of the scale value.  note
-													// that this could be negative, in which case we do
-													// not use the calculated vscale value... see the
-													// if(code>12) check below
-
-		inPtr++;									// coded adpcm data lies next
-		j=0;
-		while(j<8)									// loop of 8, for 8 coded nibbles from 4 bytes
-													// which yields 8 short pcm values
-		{
-			icode=BufferSpace[(0x4f0+inPtr)^S8];
-			inPtr++;
-
-			inp1[j]=(s16)((icode&0xf0)<<8);			// this will in effect be signed
-			if(code<12)
-				inp1[j]=((int)((int)inp1[j]*(int)vscale)>>16);
-			/*else
-				int catchme=1;*/
-			j++;
-
-			inp1[j]=(s16)((icode&0xf)<<12);
-			if(code<12)
-				inp1[j]=((int)((int)inp1[j]*(int)vscale)>>16);
-			/*else
-				int catchme=1;*/
-			j++;
-		}
-		j=0;
-		while(j<8)
-		{
-			icode=BufferSpace[(0x4f0+inPtr)^S8];
-			inPtr++;
-
-			inp2[j]=(short)((icode&0xf0)<<8);			// this will in effect be signed
-			if(code<12)
-				inp2[j]=((int)((int)inp2[j]*(int)vscale)>>16);
-			/*else
-				int catchme=1;*/
-			j++;
-
-			inp2[j]=(short)((icode&0xf)<<12);
-			if(code<12)
-				inp2[j]=((int)((int)inp2[j]*(int)vscale)>>16);
-			/*else
-				int catchme=1;*/
-			j++;
-		}
-
-		a[0]= (int)book1[0]*(int)l1;
-		a[0]+=(int)book2[0]*(int)l2;
-		a[0]+=(int)inp1[0]*(int)2048;
-
-		a[1] =(int)book1[1]*(int)l1;
-		a[1]+=(int)book2[1]*(int)l2;
-		a[1]+=(int)book2[0]*inp1[0];
-		a[1]+=(int)inp1[1]*(int)2048;
-
-		a[2] =(int)book1[2]*(int)l1;
-		a[2]+=(int)book2[2]*(int)l2;
-		a[2]+=(int)book2[1]*inp1[0];
-		a[2]+=(int)book2[0]*inp1[1];
-		a[2]+=(int)inp1[2]*(int)2048;
-
-		a[3] =(int)book1[3]*(int)l1;
-		a[3]+=(int)book2[3]*(int)l2;
-		a[3]+=(int)book2[2]*inp1[0];
-		a[3]+=(int)book2[1]*inp1[1];
-		a[3]+=(int)book2[0]*inp1[2];
-		a[3]+=(int)inp1[3]*(int)2048;
-
-		a[4] =(int)book1[4]*(int)l1;
-		a[4]+=(int)book2[4]*(int)l2;
-		a[4]+=(int)book2[3]*inp1[0];
-		a[4]+=(int)book2[2]*inp1[1];
-		a[4]+=(int)book2[1]*inp1[2];
-		a[4]+=(int)book2[0]*inp1[3];
-		a[4]+=(int)inp1[4]*(int)2048;
-
-		a[5] =(int)book1[5]*(int)l1;
-		a[5]+=(int)book2[5]*(int)l2;
-		a[5]+=(int)book2[4]*inp1[0];
-		a[5]+=(int)book2[3]*inp1[1];
-		a[5]+=(int)book2[2]*inp1[2];
-		a[5]+=(int)book2[1]*inp1[3];
-		a[5]+=(int)book2[0]*inp1[4];
-		a[5]+=(int)inp1[5]*(int)2048;
-
-		a[6] =(int)book1[6]*(int)l1;
-		a[6]+=(int)book2[6]*(int)l2;
-		a[6]+=(int)book2[5]*inp1[0];
-		a[6]+=(int)book2[4]*inp1[1];
-		a[6]+=(int)book2[3]*inp1[2];
-		a[6]+=(int)book2[2]*inp1[3];
-		a[6]+=(int)book2[1]*inp1[4];
-		a[6]+=(int)book2[0]*inp1[5];
-		a[6]+=(int)inp1[6]*(int)2048;
-
-		a[7] =(int)book1[7]*(int)l1;
-		a[7]+=(int)book2[7]*(int)l2;
-		a[7]+=(int)book2[6]*inp1[0];
-		a[7]+=(int)book2[5]*inp1[1];
-		a[7]+=(int)book2[4]*inp1[2];
-		a[7]+=(int)book2[3]*inp1[3];
-		a[7]+=(int)book2[2]*inp1[4];
-		a[7]+=(int)book2[1]*inp1[5];
-		a[7]+=(int)book2[0]*inp1[6];
-		a[7]+=(int)inp1[7]*(int)2048;
-
-		for(j=0;j<8;j++)
-		{
-			a[j^S]>>=11;
-			if(a[j^S]>32767) a[j^S]=32767;
-			else if(a[j^S]<-32768) a[j^S]=-32768;
-			*(out++)=a[j^S];
-			//*(out+j)=a[j^S];
-		}
-		//out += 0x10;
-		l1=a[6];
-		l2=a[7];
-
-		a[0]= (int)book1[0]*(int)l1;
-		a[0]+=(int)book2[0]*(int)l2;
-		a[0]+=(int)inp2[0]*(int)2048;
-
-		a[1] =(int)book1[1]*(int)l1;
-		a[1]+=(int)book2[1]*(int)l2;
-		a[1]+=(int)book2[0]*inp2[0];
-		a[1]+=(int)inp2[1]*(int)2048;
-
-		a[2] =(int)book1[2]*(int)l1;
-		a[2]+=(int)book2[2]*(int)l2;
-		a[2]+=(int)book2[1]*inp2[0];
-		a[2]+=(int)book2[0]*inp2[1];
-		a[2]+=(int)inp2[2]*(int)2048;
-
-		a[3] =(int)book1[3]*(int)l1;
-		a[3]+=(int)book2[3]*(int)l2;
-		a[3]+=(int)book2[2]*inp2[0];
-		a[3]+=(int)book2[1]*inp2[1];
-		a[3]+=(int)book2[0]*inp2[2];
-		a[3]+=(int)inp2[3]*(int)2048;
-
-		a[4] =(int)book1[4]*(int)l1;
-		a[4]+=(int)book2[4]*(int)l2;
-		a[4]+=(int)book2[3]*inp2[0];
-		a[4]+=(int)book2[2]*inp2[1];
-		a[4]+=(int)book2[1]*inp2[2];
-		a[4]+=(int)book2[0]*inp2[3];
-		a[4]+=(int)inp2[4]*(int)2048;
-
-		a[5] =(int)book1[5]*(int)l1;
-		a[5]+=(int)book2[5]*(int)l2;
-		a[5]+=(int)book2[4]*inp2[0];
-		a[5]+=(int)book2[3]*inp2[1];
-		a[5]+=(int)book2[2]*inp2[2];
-		a[5]+=(int)book2[1]*inp2[3];
-		a[5]+=(int)book2[0]*inp2[4];
-		a[5]+=(int)inp2[5]*(int)2048;
-
-		a[6] =(int)book1[6]*(int)l1;
-		a[6]+=(int)book2[6]*(int)l2;
-		a[6]+=(int)book2[5]*inp2[0];
-		a[6]+=(int)book2[4]*inp2[1];
-		a[6]+=(int)book2[3]*inp2[2];
-		a[6]+=(int)book2[2]*inp2[3];
-		a[6]+=(int)book2[1]*inp2[4];
-		a[6]+=(int)book2[0]*inp2[5];
-		a[6]+=(int)inp2[6]*(int)2048;
-
-		a[7] =(int)book1[7]*(int)l1;
-		a[7]+=(int)book2[7]*(int)l2;
-		a[7]+=(int)book2[6]*inp2[0];
-		a[7]+=(int)book2[5]*inp2[1];
-		a[7]+=(int)book2[4]*inp2[2];
-		a[7]+=(int)book2[3]*inp2[3];
-		a[7]+=(int)book2[2]*inp2[4];
-		a[7]+=(int)book2[1]*inp2[5];
-		a[7]+=(int)book2[0]*inp2[6];
-		a[7]+=(int)inp2[7]*(int)2048;
-
-		for(j=0;j<8;j++)
-		{
-			a[j^S]>>=11;
-			if(a[j^S]>32767) a[j^S]=32767;
-			else if(a[j^S]<-32768) a[j^S]=-32768;
-			*(out++)=a[j^S];
-			//*(out+j+0x1f8)=a[j^S];
-		}
-		l1=a[6];
-		l2=a[7];
-
-		count-=32;
-	}
-	out-=16;
+	out = hle_adpcm_decode(BufferSpace, 0x4f0+inPtr, out, count, adpcmtable, 4, 12);
 	memcpy(&rsp.RDRAM[Address],out,32);
+	hle_rdram_written(Address, 32);
 }
 
 static void RESAMPLE3 () {
 	BYTE Flags=(u8)((inst2>>0x1e));
 	DWORD Pitch=((inst2>>0xe)&0xffff)<<1;
 	u32 addy = (inst1 & 0xffffff);
-	DWORD Accum=0;
-	DWORD location;
-	s16 *lut;
-	short *dst;
+	u32 Accum=0;
 	s16 *src;
-	dst=(short *)(BufferSpace);
 	src=(s16 *)(BufferSpace);
 	u32 srcPtr=((((inst2>>2)&0xfff)+0x4f0)/2);
 	u32 dstPtr;//=(AudioOutBuffer/2);
-	s32 temp;
-	s32 accum;
 
 	//if (addy > (1024*1024*8))
 	//	addy = (inst2 & 0xffffff);
@@ -853,66 +590,12 @@ static void RESAMPLE3 () {
 	//if ((Flags & 0x2))
 	//	__asm int 3;
 
-	for(int i=0;i < 0x170/2;i++)	{
-		location = (((Accum * 0x40) >> 0x10) * 8);
-		//location = (Accum >> 0xa) << 0x3;
-		lut = (s16 *)(((u8 *)ResampleLUT) + location);
-
-		temp =  ((s32)*(s16*)(src+((srcPtr+0)^S))*((s32)((s16)lut[0])));
-		accum = (s32)(temp >> 15);
-
-		temp = ((s32)*(s16*)(src+((srcPtr+1)^S))*((s32)((s16)lut[1])));
-		accum += (s32)(temp >> 15);
-
-		temp = ((s32)*(s16*)(src+((srcPtr+2)^S))*((s32)((s16)lut[2])));
-		accum += (s32)(temp >> 15);
-
-		temp = ((s32)*(s16*)(src+((srcPtr+3)^S))*((s32)((s16)lut[3])));
-		accum += (s32)(temp >> 15);
-/*		temp =  ((s64)*(s16*)(src+((srcPtr+0)^S))*((s64)((s16)lut[0]<<1)));
-		if (temp & 0x8000) temp = (temp^0x8000) + 0x10000;
-		else temp = (temp^0x8000);
-		temp = (s32)(temp >> 16);
-		if ((s32)temp > 32767) temp = 32767;
-		if ((s32)temp < -32768) temp = -32768;
-		accum = (s32)(s16)temp;
-
-		temp = ((s64)*(s16*)(src+((srcPtr+1)^S))*((s64)((s16)lut[1]<<1)));
-		if (temp & 0x8000) temp = (temp^0x8000) + 0x10000;
-		else temp = (temp^0x8000);
-		temp = (s32)(temp >> 16);
-		if ((s32)temp > 32767) temp = 32767;
-		if ((s32)temp < -32768) temp = -32768;
-		accum += (s32)(s16)temp;
-
-		temp = ((s64)*(s16*)(src+((srcPtr+2)^S))*((s64)((s16)lut[2]<<1)));
-		if (temp & 0x8000) temp = (temp^0x8000) + 0x10000;
-		else temp = (temp^0x8000);
-		temp = (s32)(temp >> 16);
-		if ((s32)temp > 32767) temp = 32767;
-		if ((s32)temp < -32768) temp = -32768;
-		accum += (s32)(s16)temp;
-
-		temp = ((s64)*(s16*)(src+((srcPtr+3)^S))*((s64)((s16)lut[3]<<1)));
-		if (temp & 0x8000) temp = (temp^0x8000) + 0x10000;
-		else temp = (temp^0x8000);
-		temp = (s32)(temp >> 16);
-		if ((s32)temp > 32767) temp = 32767;
-		if ((s32)temp < -32768) temp = -32768;
-		accum += (s32)(s16)temp;*/
-
-		if (accum > 32767) accum = 32767;
-		if (accum < -32768) accum = -32768;
-
-		dst[dstPtr^S] = (accum);
-		dstPtr++;
-		Accum += Pitch;
-		srcPtr += (Accum>>16);
-		Accum&=0xffff;
-	}
+	srcPtr = hle_resample(src, srcPtr, dstPtr, 0x170/2, Pitch, &Accum, (s16 *)ResampleLUT);
+
 	for (int x=0; x < 4; x++)
 		((u16 *)rsp.RDRAM)[((addy/2)+x)^S] = src[(srcPtr+x)^S];
 	*(u16 *)(rsp.RDRAM+addy+10) = Accum;
+	hle_rdram_written(addy, 12);
 }
 
 static void INTERLEAVE3 () { // Needs accuracy verification...
@@ -149,9 +149,10 @@ static u16 DeWindowLUT [0x420] = {
 
 static u8 mp3data[0x1000];
 
-static s32 v[32];
+// Parts 1 and 6 pair subband sample MP3_PAIR[i] with 31-MP3_PAIR[i]
+static const u8 MP3_PAIR[16] = { 0, 1, 3, 2, 7, 6, 4, 5, 15, 14, 12, 13, 8, 9, 11, 10 };
 
-static void MP3AB0 () {
+static void MP3AB0 (s32 *v) {
 	// Part 2 - 100% Accurate
 	const u16 LUT2[8] = { 0xFEC4, 0xF4FA, 0xC5E4, 0xE1C4,
 						  0x1916, 0x4A50, 0xA268, 0x78AE };
@@ -229,6 +230,7 @@ void MP3 () {
 		}
 // --------------- Inner Loop End --------------------
 		memcpy (rsp.RDRAM+writePtr, mp3data+0xe70, 0x180);
+		hle_rdram_written(writePtr, 0x180);
 		writePtr += 0x180;
 		readPtr  += 0x180;
 	}
@@ -240,29 +242,16 @@ static void InnerLoop () {
 				// Part 1: 100% Accurate
 
 				int i;
-				v[0] = *(s16 *)(mp3data+inPtr+(0x00^S16)); v[31] = *(s16 *)(mp3data+inPtr+(0x3E^S16)); v[0] += v[31];
-				v[1] = *(s16 *)(mp3data+inPtr+(0x02^S16)); v[30] = *(s16 *)(mp3data+inPtr+(0x3C^S16)); v[1] += v[30];
-				v[2] = *(s16 *)(mp3data+inPtr+(0x06^S16)); v[28] = *(s16 *)(mp3data+inPtr+(0x38^S16)); v[2] += v[28];
-				v[3] = *(s16 *)(mp3data+inPtr+(0x04^S16)); v[29] = *(s16 *)(mp3data+inPtr+(0x3A^S16)); v[3] += v[29];
-
-				v[4] = *(s16 *)(mp3data+inPtr+(0x0E^S16)); v[24] = *(s16 *)(mp3data+inPtr+(0x30^S16)); v[4] += v[24];
-				v[5] = *(s16 *)(mp3data+inPtr+(0x0C^S16)); v[25] = *(s16 *)(mp3data+inPtr+(0x32^S16)); v[5] += v[25];
-				v[6] = *(s16 *)(mp3data+inPtr+(0x08^S16)); v[27] = *(s16 *)(mp3data+inPtr+(0x36^S16)); v[6] += v[27];
-				v[7] = *(s16 *)(mp3data+inPtr+(0x0A^S16)); v[26] = *(s16 *)(mp3data+inPtr+(0x34^S16)); v[7] += v[26];
-
-				v[8] = *(s16 *)(mp3data+inPtr+(0x1E^S16)); v[16] = *(s16 *)(mp3data+inPtr+(0x20^S16)); v[8] += v[16];
-				v[9] = *(s16 *)(mp3data+inPtr+(0x1C^S16)); v[17] = *(s16 *)(mp3data+inPtr+(0x22^S16)); v[9] += v[17];
-				v[10]= *(s16 *)(mp3data+inPtr+(0x18^S16)); v[19] = *(s16 *)(mp3data+inPtr+(0x26^S16)); v[10]+= v[19];
-				v[11]= *(s16 *)(mp3data+inPtr+(0x1A^S16)); v[18] = *(s16 *)(mp3data+inPtr+(0x24^S16)); v[11]+= v[18];
-
-				v[12]= *(s16 *)(mp3data+inPtr+(0x10^S16)); v[23] = *(s16 *)(mp3data+inPtr+(0x2E^S16)); v[12]+= v[23];
-				v[13]= *(s16 *)(mp3data+inPtr+(0x12^S16)); v[22] = *(s16 *)(mp3data+inPtr+(0x2C^S16)); v[13]+= v[22];
-				v[14]= *(s16 *)(mp3data+inPtr+(0x16^S16)); v[20] = *(s16 *)(mp3data+inPtr+(0x28^S16)); v[14]+= v[20];
-				v[15]= *(s16 *)(mp3data+inPtr+(0x14^S16)); v[21] = *(s16 *)(mp3data+inPtr+(0x2A^S16)); v[15]+= v[21];
+				s32 v[32], in[32];
+				// Each sample is loaded once for both parts
+				for (i = 0; i < 32; i++)
+					in[i] = *(s16 *)(mp3data+inPtr+((i*2)^S16));
+				for (i = 0; i < 16; i++)
+					v[i] = in[MP3_PAIR[i]] + in[31-MP3_PAIR[i]];
 
 				// Part 2-4
 
-				MP3AB0 ();
+				MP3AB0 (v);
 
 				// Part 5 - 1-Wide Butterflies - 100% Accurate but need SSVs!!!
 
@@ -364,25 +353,8 @@ static void InnerLoop () {
 
 				// Part 6 - 100% Accurate
 
-				v[0] = *(s16 *)(mp3data+inPtr+(0x00^S16)); v[31] = *(s16 *)(mp3data+inPtr+(0x3E^S16)); v[0] -= v[31];
-				v[1] = *(s16 *)(mp3data+inPtr+(0x02^S16)); v[30] = *(s16 *)(mp3data+inPtr+(0x3C^S16)); v[1] -= v[30];
-				v[2] = *(s16 *)(mp3data+inPtr+(0x06^S16)); v[28] = *(s16 *)(mp3data+inPtr+(0x38^S16)); v[2] -= v[28];
-				v[3] = *(s16 *)(mp3data+inPtr+(0x04^S16)); v[29] = *(s16 *)(mp3data+inPtr+(0x3A^S16)); v[3] -= v[29];
-
-				v[4] = *(s16 *)(mp3data+inPtr+(0x0E^S16)); v[24] = *(s16 *)(mp3data+inPtr+(0x30^S16)); v[4] -= v[24];
-				v[5] = *(s16 *)(mp3data+inPtr+(0x0C^S16)); v[25] = *(s16 *)(mp3data+inPtr+(0x32^S16)); v[5] -= v[25];
-				v[6] = *(s16 *)(mp3data+inPtr+(0x08^S16)); v[27] = *(s16 *)(mp3data+inPtr+(0x36^S16)); v[6] -= v[27];
-				v[7] = *(s16 *)(mp3data+inPtr+(0x0A^S16)); v[26] = *(s16 *)(mp3data+inPtr+(0x34^S16)); v[7] -= v[26];
-
-				v[8] = *(s16 *)(mp3data+inPtr+(0x1E^S16)); v[16] = *(s16 *)(mp3data+inPtr+(0x20^S16)); v[8] -= v[16];
-				v[9] = *(s16 *)(mp3data+inPtr+(0x1C^S16)); v[17] = *(s16 *)(mp3data+inPtr+(0x22^S16)); v[9] -= v[17];
-				v[10]= *(s16 *)(mp3data+inPtr+(0x18^S16)); v[19] = *(s16 *)(mp3data+inPtr+(0x26^S16)); v[10]-= v[19];
-				v[11]= *(s16 *)(mp3data+inPtr+(0x1A^S16)); v[18] = *(s16 *)(mp3data+inPtr+(0x24^S16)); v[11]-= v[18];
-
-				v[12]= *(s16 *)(mp3data+inPtr+(0x10^S16)); v[23] = *(s16 *)(mp3data+inPtr+(0x2E^S16)); v[12]-= v[23];
-				v[13]= *(s16 *)(mp3data+inPtr+(0x12^S16)); v[22] = *(s16 *)(mp3data+inPtr+(0x2C^S16)); v[13]-= v[22];
-				v[14]= *(s16 *)(mp3data+inPtr+(0x16^S16)); v[20] = *(s16 *)(mp3data+inPtr+(0x28^S16)); v[14]-= v[20];
-				v[15]= *(s16 *)(mp3data+inPtr+(0x14^S16)); v[21] = *(s16 *)(mp3data+inPtr+(0x2A^S16)); v[15]-= v[21];
+				for (i = 0; i < 16; i++)
+					v[i] = in[MP3_PAIR[i]] - in[31-MP3_PAIR[i]];
 
 				//0, 1, 3, 2, 7, 6, 4, 5, 7, 6, 4, 5, 0, 1, 3, 2
 				const u16 LUT6[16] = { 0xFFB2, 0xFD3A, 0xF10A, 0xF854,
@@ -397,7 +369,7 @@ static void InnerLoop () {
 				v[5] = v[5] + v[5]; v[6] = v[6] + v[6]; v[7] = v[7] + v[7];
 				v[12] = v[12] + v[12]; v[13] = v[13] + v[13]; v[15] = v[15] + v[15];
 
-				MP3AB0 ();
+				MP3AB0 (v);
 
 				// Part 7: - 100% Accurate + SSV - Unoptimized
 
@@ -475,50 +447,34 @@ static void InnerLoop () {
 
 				// Step 8 - Dewindowing
 
-				//u64 *DW = (u64 *)&DeWindowLUT[0x10-(t4>>1)];
-				u32 offset = 0x10-(t4>>1);
-
-				u32 addptr = t6 & 0xFFE0;
-				offset = 0x10-(t4>>1);
-
-				s32 v2=0, v4=0, v6=0, v8=0;
-				//s32 z2=0, z4=0, z6=0, z8=0;
-
-				offset = 0x10-(t4>>1);// + x*0x40;
+				// Every product is rounded to 16 bits on its own, as vmulf
+				//   did, so these are straight sums of rounded products
+#define MP3_DW(a, b) (((int)(a) * (int)(b) + 0x4000) >> 0xF)
+				const s16 *src = (const s16 *)(mp3data + (t6 & 0xFFE0));
+				const s16 *win = (const s16 *)DeWindowLUT + 0x10-(t4>>1);
+				s32 v2, v4, v6, v8;
 				int x;
 				for (x = 0; x < 8; x++) {
 					v2 = v4 = v6 = v8 = 0;
-
-					//addptr = t1;
-
-					for (i = 7; i >= 0; i--) {
-						v2 += ((int)*(s16 *)(mp3data+(addptr)+0x00) * (short)DeWindowLUT[offset+0x00] + 0x4000) >> 0xF;
-						v4 += ((int)*(s16 *)(mp3data+(addptr)+0x10) * (short)DeWindowLUT[offset+0x08] + 0x4000) >> 0xF;
-						v6 += ((int)*(s16 *)(mp3data+(addptr)+0x20) * (short)DeWindowLUT[offset+0x20] + 0x4000) >> 0xF;
-						v8 += ((int)*(s16 *)(mp3data+(addptr)+0x30) * (short)DeWindowLUT[offset+0x28] + 0x4000) >> 0xF;
-						addptr+=2; offset++;
+					for (i = 0; i < 8; i++) {
+						v2 += MP3_DW(src[i+0x00], win[i+0x00]);
+						v4 += MP3_DW(src[i+0x08], win[i+0x08]);
+						v6 += MP3_DW(src[i+0x10], win[i+0x20]);
+						v8 += MP3_DW(src[i+0x18], win[i+0x28]);
 					}
-					s32 v0  = v2 + v4;
-					s32 v18 = v6 + v8;
-					//Clamp(v0);
-					//Clamp(v18);
-					// clamp???
-					*(s16 *)(mp3data+(outPtr^S16)) = v0;
-					*(s16 *)(mp3data+((outPtr+2)^S16)) = v18;
+					*(s16 *)(mp3data+(outPtr^S16)) = v2 + v4;
+					*(s16 *)(mp3data+((outPtr+2)^S16)) = v6 + v8;
 					outPtr+=4;
-					addptr += 0x30;
-					offset += 0x38;
+					src += 0x20;
+					win += 0x40;
 				}
 
-				offset = 0x10-(t4>>1) + 8*0x40;
 				v2 = v4 = 0;
-				for (i = 0; i < 4; i++) {
-					v2 += ((int)*(s16 *)(mp3data+(addptr)+0x00) * (short)DeWindowLUT[offset+0x00] + 0x4000) >> 0xF;
-					v2 += ((int)*(s16 *)(mp3data+(addptr)+0x10) * (short)DeWindowLUT[offset+0x08] + 0x4000) >> 0xF;
-					addptr+=2; offset++;
-					v4 += ((int)*(s16 *)(mp3data+(addptr)+0x00) * (short)DeWindowLUT[offset+0x00] + 0x4000) >> 0xF;
-					v4 += ((int)*(s16 *)(mp3data+(addptr)+0x10) * (short)DeWindowLUT[offset+0x08] + 0x4000) >> 0xF;
-					addptr+=2; offset++;
+				for (i = 0; i < 8; i += 2) {
+					v2 += MP3_DW(src[i],   win[i]);
+					v2 += MP3_DW(src[i+8], win[i+8]);
+					v4 += MP3_DW(src[i+1], win[i+1]);
+					v4 += MP3_DW(src[i+9], win[i+9]);
 				}
 				s32 mult6 = *(s32 *)(mp3data+0xCE8);
 				s32 mult4 = *(s32 *)(mp3data+0xCEC);
@@ -530,63 +486,51 @@ static void InnerLoop () {
 					*(s16 *)(mp3data+(outPtr^S16)) = v4;
 					mult4 = *(u32 *)(mp3data+0xCE8);
 				}
-				addptr -= 0x50;
+				src -= 0x20;
 
 				for (x = 0; x < 8; x++) {
 					v2 = v4 = v6 = v8 = 0;
-
-					offset = (0x22F-(t4>>1) + x*0x40);
-
-					for (i = 0; i < 4; i++) {
-						v2 += ((int)*(s16 *)(mp3data+(addptr    )+0x20) * (short)DeWindowLUT[offset+0x00] + 0x4000) >> 0xF;
-						v2 -= ((int)*(s16 *)(mp3data+((addptr+2))+0x20) * (short)DeWindowLUT[offset+0x01] + 0x4000) >> 0xF;
-						v4 += ((int)*(s16 *)(mp3data+(addptr    )+0x30) * (short)DeWindowLUT[offset+0x08] + 0x4000) >> 0xF;
-						v4 -= ((int)*(s16 *)(mp3data+((addptr+2))+0x30) * (short)DeWindowLUT[offset+0x09] + 0x4000) >> 0xF;
-						v6 += ((int)*(s16 *)(mp3data+(addptr    )+0x00) * (short)DeWindowLUT[offset+0x20] + 0x4000) >> 0xF;
-						v6 -= ((int)*(s16 *)(mp3data+((addptr+2))+0x00) * (short)DeWindowLUT[offset+0x21] + 0x4000) >> 0xF;
-						v8 += ((int)*(s16 *)(mp3data+(addptr    )+0x10) * (short)DeWindowLUT[offset+0x28] + 0x4000) >> 0xF;
-						v8 -= ((int)*(s16 *)(mp3data+((addptr+2))+0x10) * (short)DeWindowLUT[offset+0x29] + 0x4000) >> 0xF;
-						addptr+=4; offset+=2;
+					win = (const s16 *)DeWindowLUT + 0x22F-(t4>>1) + x*0x40;
+					for (i = 0; i < 8; i += 2) {
+						v2 += MP3_DW(src[i+0x10], win[i+0x00]);
+						v2 -= MP3_DW(src[i+0x11], win[i+0x01]);
+						v4 += MP3_DW(src[i+0x18], win[i+0x08]);
+						v4 -= MP3_DW(src[i+0x19], win[i+0x09]);
+						v6 += MP3_DW(src[i+0x00], win[i+0x20]);
+						v6 -= MP3_DW(src[i+0x01], win[i+0x21]);
+						v8 += MP3_DW(src[i+0x08], win[i+0x28]);
+						v8 -= MP3_DW(src[i+0x09], win[i+0x29]);
 					}
-					s32 v0  = v2 + v4;
-					s32 v18 = v6 + v8;
-					//Clamp(v0);
-					//Clamp(v18);
-					// clamp???
-					*(s16 *)(mp3data+((outPtr+2)^S16)) = v0;
-					*(s16 *)(mp3data+((outPtr+4)^S16)) = v18;
+					*(s16 *)(mp3data+((outPtr+2)^S16)) = v2 + v4;
+					*(s16 *)(mp3data+((outPtr+4)^S16)) = v6 + v8;
 					outPtr+=4;
-					addptr -= 0x50;
+					src -= 0x20;
 				}
+#undef MP3_DW
 
 				int tmp = outPtr;
 				s32 hi0 = mult6;
 				s32 hi1 = mult4;
-				s32 v;
-				/*
-				if (hi0 & 0xffff)
-					__asm int 3;
-				if (hi1 & 0xffff)
-					__asm int 3;*/
+				s32 s;
 				hi0 = (int)hi0 >> 0x10;
 				hi1 = (int)hi1 >> 0x10;
 				for (i = 0; i < 8; i++) {
 					// v0
-					v = (*(s16 *)(mp3data+((tmp-0x40)^S16)) * hi0);
-					if (v > 32767) v = 32767; else if (v < -32767) v = -32767;
-					*(s16 *)((u8 *)mp3data+((tmp-0x40)^S16)) = (s16)v;
+					s = (*(s16 *)(mp3data+((tmp-0x40)^S16)) * hi0);
+					if (s > 32767) s = 32767; else if (s < -32767) s = -32767;
+					*(s16 *)((u8 *)mp3data+((tmp-0x40)^S16)) = (s16)s;
 					// v17
-					v = (*(s16 *)(mp3data+((tmp-0x30)^S16)) * hi0);
-					if (v > 32767) v = 32767; else if (v < -32767) v = -32767;
-					*(s16 *)((u8 *)mp3data+((tmp-0x30)^S16)) = v;
+					s = (*(s16 *)(mp3data+((tmp-0x30)^S16)) * hi0);
+					if (s > 32767) s = 32767; else if (s < -32767) s = -32767;
+					*(s16 *)((u8 *)mp3data+((tmp-0x30)^S16)) = s;
 					// v2
-					v = (*(s16 *)(mp3data+((tmp-0x1E)^S16)) * hi1);
-					if (v > 32767) v = 32767; else if (v < -32767) v = -32767;
-					*(s16 *)((u8 *)mp3data+((tmp-0x1E)^S16)) = v;
+					s = (*(s16 *)(mp3data+((tmp-0x1E)^S16)) * hi1);
+					if (s > 32767) s = 32767; else if (s < -32767) s = -32767;
+					*(s16 *)((u8 *)mp3data+((tmp-0x1E)^S16)) = s;
 					// v4
-					v = (*(s16 *)(mp3data+((tmp-0xE)^S16)) * hi1);
-					if (v > 32767) v = 32767; else if (v < -32767) v = -32767;
-					*(s16 *)((u8 *)mp3data+((tmp-0xE)^S16)) = v;
+					s = (*(s16 *)(mp3data+((tmp-0xE)^S16)) * hi1);
+					if (s > 32767) s = 32767; else if (s < -32767) s = -32767;
+					*(s16 *)((u8 *)mp3data+((tmp-0xE)^S16)) = s;
 					tmp += 2;
 				}
 }
@@ -0,0 +1,145 @@
+/**
+ * Wii64 - mp3bench.cpp
+ *
+ * Checks that the MP3 ucode (rsp_hle/ucode3mp3.cpp) produces exactly the
+ *   same PCM as the reference copy in ucode3mp3_ref.cpp, and times both.
+ *   This is a host tool, build it with:  c++ -O2 -o mp3bench mp3bench.cpp
+ *   Add -D_BIG_ENDIAN to check the byte order the GameCube/Wii build uses.
+ *
+ * Usage: mp3bench [-bench] [seed]
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../rsp_hle/wintypes.h"
+
+extern "C" {
+#include "../rsp_hle/hle.h"
+unsigned int rdram_page_gen[CODE_RDRAM_SIZE>>12];
+}
+
+RSP_INFO rsp;
+u32 inst1, inst2;
+
+// Each copy of the ucode gets its own statics, they're included only once
+//   since the headers they include have been already
+namespace cur {
+#include "../rsp_hle/ucode3mp3.cpp"
+}
+namespace ref {
+#include "ucode3mp3_ref.cpp"
+}
+
+#define RDRAM_SIZE  0x20000
+#define TASK_ADDR   0x1000
+#define TASK_SIZE   0x480
+#define TASK_IN     0x488
+#define CHECK_TASKS 3000
+#define BENCH_TASKS 20000
+#define BENCH_INPUT 64   // distinct inputs the benchmark cycles through
+#define BENCH_RUNS  5    // the best run is reported
+
+static BYTE* rdram_cur;
+static BYTE* rdram_ref;
+static BYTE  bench_in[BENCH_INPUT][TASK_IN];
+static u32   bench_inst1[BENCH_INPUT];
+
+// Mostly small samples like real streams, sometimes full scale
+static void make_task(BYTE* in){
+	int full = rand() % 4 == 0;
+	int i;
+	for(i=0; i<TASK_IN; i+=2){
+		int s = full ? (rand() & 0xFFFF) - 0x8000 : (rand() % 4096) - 2048;
+		in[i]   = s >> 8;
+		in[i+1] = s;
+	}
+	if(!full){
+		in[0] = 0x7F;
+		in[4] = 0x7F;
+	}
+	inst1 = rand() & 0xFF;
+	inst2 = TASK_ADDR;
+}
+
+static int check(int seed){
+	int task, i;
+	srand(seed);
+	memset(rdram_cur, 0, RDRAM_SIZE);
+	memset(rdram_ref, 0, RDRAM_SIZE);
+	for(task=0; task<CHECK_TASKS; ++task){
+		make_task(rdram_cur + TASK_ADDR);
+		memcpy(rdram_ref + TASK_ADDR, rdram_cur + TASK_ADDR, TASK_IN);
+
+		rsp.RDRAM = rdram_cur; cur::MP3();
+		rsp.RDRAM = rdram_ref; ref::MP3();
+
+		for(i=0; i<TASK_SIZE; ++i)
+			if(rdram_cur[TASK_ADDR+i] != rdram_ref[TASK_ADDR+i]){
+				printf("seed %d task %d: byte 0x%x is %02x, reference has %02x\n",
+				       seed, task, i, rdram_cur[TASK_ADDR+i], rdram_ref[TASK_ADDR+i]);
+				return 0;
+			}
+	}
+	printf("seed %d: %d tasks match\n", seed, CHECK_TASKS);
+	return 1;
+}
+
+// The inputs are made up front so only copying them in gets timed
+static double bench(void (*mp3)(), BYTE* ram){
+	double best = 0;
+	int run, task;
+	rsp.RDRAM = ram;
+	inst2 = TASK_ADDR;
+	for(run=0; run<BENCH_RUNS; ++run){
+		clock_t start = clock();
+		for(task=0; task<BENCH_TASKS; ++task){
+			memcpy(ram + TASK_ADDR, bench_in[task % BENCH_INPUT], TASK_IN);
+			inst1 = bench_inst1[task % BENCH_INPUT];
+			mp3();
+		}
+		double t = (double)(clock() - start) / CLOCKS_PER_SEC;
+		if(!run || t < best) best = t;
+	}
+	return best;
+}
+
+int main(int argc, char* argv[]){
+	int arg = 1, seed;
+
+	rdram_cur = (BYTE*)calloc(RDRAM_SIZE, 1);
+	rdram_ref = (BYTE*)calloc(RDRAM_SIZE, 1);
+	if(!rdram_cur || !rdram_ref) return 1;
+
+	if(arg < argc && !strcmp(argv[arg], "-bench")){
+		srand(1);
+		for(seed=0; seed<BENCH_INPUT; ++seed){
+			make_task(bench_in[seed]);
+			bench_inst1[seed] = inst1;
+		}
+		double t_ref = bench(ref::MP3, rdram_ref);
+		double t_cur = bench(cur::MP3, rdram_cur);
+		printf("%d tasks: reference %.3f s, current %.3f s\n", BENCH_TASKS, t_ref, t_cur);
+		return 0;
+	}
+
+	if(arg < argc) return !check(atoi(argv[arg]));
+	for(seed=1; seed<=4; ++seed)
+		if(!check(seed)) return 1;
+	return 0;
+}
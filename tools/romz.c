@@ -0,0 +1,115 @@
+/**
+ * Wii64 - romz.c
+ *
+ * Converts an N64 ROM image into a block compressed ROMZ image which
+ *   fileBrowser-ROMZ can read a block at a time (see fileBrowser-ROMZ.h).
+ *   This is a host tool, build it with:  cc -O2 -o romz romz.c ../main/lz4.c -lz
+ *
+ * Usage: romz [-lz4] in.z64 out.romz
+ *
+ * Wii64 homepage: http://www.emulatemii.com
+ *
+ *
+ * This program is free software; you can redistribute it and/
+ * or modify it under the terms of the GNU General Public Li-
+ * cence as published by the Free Software Foundation; either
+ * version 2 of the Licence, or any later version.
+ *
+ * This program is distributed in the hope that it will be use-
+ * ful, but WITHOUT ANY WARRANTY; without even the implied war-
+ * ranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public Licence for more details.
+ *
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "../fileBrowser/fileBrowser-ROMZ.h"
+#include "../main/lz4.h"
+
+#define BLOCK_SIZE (1 << ROMZ_BLOCK_SHIFT)
+
+static void put_be32(unsigned char* p, unsigned int v){
+	p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+int main(int argc, char* argv[]){
+	int codec = ROMZ_CODEC_ZLIB;
+	int arg = 1;
+	if(argc > 1 && !strcmp(argv[1], "-lz4")){
+		codec = ROMZ_CODEC_LZ4;
+		++arg;
+	}
+	if(argc - arg != 2){
+		fprintf(stderr, "Usage: %s [-lz4] in.z64 out.romz\n", argv[0]);
+		return 1;
+	}
+
+	FILE* in = fopen(argv[arg], "rb");
+	if(!in){ perror(argv[arg]); return 1; }
+	fseek(in, 0, SEEK_END);
+	unsigned int rom_size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	unsigned char* rom = malloc(rom_size);
+	if(!rom || fread(rom, 1, rom_size, in) != rom_size){
+		fprintf(stderr, "%s: read failed\n", argv[arg]);
+		return 1;
+	}
+	fclose(in);
+
+	unsigned int num_blocks = (rom_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	unsigned int data_start = ROMZ_HEADER_SIZE + (num_blocks+1) * 4;
+	unsigned char* index = malloc((num_blocks+1) * 4);
+	unsigned char* comp = malloc(compressBound(BLOCK_SIZE));
+	static int table[LZ4_HASH_SIZE];
+	unsigned char header[ROMZ_HEADER_SIZE];
+
+	FILE* out = fopen(argv[arg+1], "wb");
+	if(!out){ perror(argv[arg+1]); return 1; }
+	// The header and index are written once all block sizes are known
+	fseek(out, data_start, SEEK_SET);
+
+	unsigned int offset = data_start, i;
+	for(i=0; i<num_blocks; ++i){
+		unsigned char* block = rom + i*BLOCK_SIZE;
+		unsigned int length = rom_size - i*BLOCK_SIZE;
+		if(length > BLOCK_SIZE) length = BLOCK_SIZE;
+		int comp_len;
+
+		if(codec == ROMZ_CODEC_LZ4){
+			comp_len = lz4_compress(block, length, comp, length - 1, table);
+		} else {
+			uLongf dest_len = compressBound(BLOCK_SIZE);
+			comp_len = compress2(comp, &dest_len, block, length, 9) == Z_OK
+			             ? (int)dest_len : -1;
+		}
+
+		put_be32(index + i*4, offset);
+		if(comp_len < 0 || (unsigned int)comp_len >= length){
+			fwrite(block, 1, length, out);
+			offset += length;
+		} else {
+			fwrite(comp, 1, comp_len, out);
+			offset += comp_len;
+		}
+	}
+	put_be32(index + num_blocks*4, offset);
+
+	put_be32(header,    ROMZ_MAGIC);
+	put_be32(header+4,  ROMZ_VERSION);
+	put_be32(header+8,  codec);
+	put_be32(header+12, ROMZ_BLOCK_SHIFT);
+	put_be32(header+16, rom_size);
+	put_be32(header+20, num_blocks);
+	fseek(out, 0, SEEK_SET);
+	fwrite(header, 1, ROMZ_HEADER_SIZE, out);
+	fwrite(index, 1, (num_blocks+1) * 4, out);
+	if(fclose(out)){ perror(argv[arg+1]); return 1; }
+
+	printf("%s: %u -> %u bytes in %u blocks\n",
+	       argv[arg+1], rom_size, offset, num_blocks);
+	return 0;
+}
+